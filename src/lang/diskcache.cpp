@@ -0,0 +1,155 @@
+#include "diskcache.h"
+
+#include <fstream>
+#include <iomanip>
+#include <sstream>
+#include <vector>
+
+#include <QDir>
+#include <QOpenGLContext>
+#include <QStandardPaths>
+
+#include "helper.h"
+
+#ifndef GL_PROGRAM_BINARY_RETRIEVABLE_HINT
+#define GL_PROGRAM_BINARY_RETRIEVABLE_HINT 0x8257
+#endif
+#ifndef GL_PROGRAM_BINARY_LENGTH
+#define GL_PROGRAM_BINARY_LENGTH 0x8741
+#endif
+#ifndef GL_NUM_PROGRAM_BINARY_FORMATS
+#define GL_NUM_PROGRAM_BINARY_FORMATS 0x87FE
+#endif
+
+namespace Wyatt {
+
+void DiskCache::open(QOpenGLFunctions* gl) {
+    if(this->gl == gl) {
+        return;
+    }
+    this->gl = gl;
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    QString location = QStandardPaths::writableLocation(QStandardPaths::CacheLocation);
+    if(context == nullptr || location.isEmpty()) {
+        return;
+    }
+
+    string driver = "version " + to_string(DISK_CACHE_VERSION) + "\n";
+    driver += string((const char*) gl->glGetString(GL_VENDOR)) + "\n";
+    driver += string((const char*) gl->glGetString(GL_RENDERER)) + "\n";
+    driver += string((const char*) gl->glGetString(GL_VERSION)) + "\n";
+
+    QDir dir(location + "/programs");
+    string manifest = dir.filePath("manifest").toStdString();
+    if(!file_exists(manifest) || str_from_file(manifest) != driver) {
+        dir.removeRecursively();
+        if(!dir.mkpath(".")) {
+            return;
+        }
+        ofstream out(manifest, ios::binary);
+        out << driver;
+    }
+    directory = dir.absolutePath().toStdString();
+
+    QSurfaceFormat format = context->format();
+    bool binaries = context->hasExtension("GL_ARB_get_program_binary") ||
+                    (context->isOpenGLES() && format.majorVersion() >= 3) ||
+                    (!context->isOpenGLES() && format.version() >= qMakePair(4, 1));
+    if(binaries) {
+        getProgramBinary = (GetProgramBinary) context->getProcAddress("glGetProgramBinary");
+        programBinary = (ProgramBinary) context->getProcAddress("glProgramBinary");
+        programParameteri = (ProgramParameteri) context->getProcAddress("glProgramParameteri");
+
+        GLint formats = 0;
+        gl->glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+        if(formats == 0 || getProgramBinary == nullptr || programBinary == nullptr) {
+            getProgramBinary = nullptr;
+            programBinary = nullptr;
+        }
+    }
+}
+
+string DiskCache::path(unsigned long long key, const string& extension) {
+    ostringstream name;
+    name << directory << "/" << hex << setw(16) << setfill('0') << key << extension;
+    return name.str();
+}
+
+bool DiskCache::load_glsl(unsigned long long key, string& code) {
+    if(!is_open()) {
+        return false;
+    }
+    ifstream in(path(key, ".glsl"), ios::binary);
+    if(!in.is_open()) {
+        missCount++;
+        return false;
+    }
+    code.assign(istreambuf_iterator<char>(in), istreambuf_iterator<char>());
+    hitCount++;
+    return true;
+}
+
+void DiskCache::store_glsl(unsigned long long key, const string& code) {
+    if(!is_open()) {
+        return;
+    }
+    ofstream out(path(key, ".glsl"), ios::binary);
+    out << code;
+}
+
+void DiskCache::prepare_program(GLuint program) {
+    if(is_open() && getProgramBinary != nullptr && programParameteri != nullptr) {
+        programParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+    }
+}
+
+GLuint DiskCache::load_program(unsigned long long key) {
+    if(!is_open() || programBinary == nullptr) {
+        return 0;
+    }
+
+    ifstream in(path(key, ".bin"), ios::binary);
+    GLenum format;
+    if(!in.read((char*) &format, sizeof(format))) {
+        missCount++;
+        return 0;
+    }
+    vector<char> binary((istreambuf_iterator<char>(in)), istreambuf_iterator<char>());
+
+    GLuint program = gl->glCreateProgram();
+    programBinary(program, format, binary.data(), binary.size());
+
+    // Drivers may reject a binary even with the same version string, e.g. after a settings change
+    GLint success;
+    gl->glGetProgramiv(program, GL_LINK_STATUS, &success);
+    if(success != GL_TRUE) {
+        gl->glDeleteProgram(program);
+        missCount++;
+        return 0;
+    }
+
+    hitCount++;
+    return program;
+}
+
+void DiskCache::store_program(unsigned long long key, GLuint program) {
+    if(!is_open() || getProgramBinary == nullptr) {
+        return;
+    }
+
+    GLint length = 0;
+    gl->glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+    if(length <= 0) {
+        return;
+    }
+
+    vector<char> binary(length);
+    GLenum format;
+    getProgramBinary(program, length, nullptr, &format, binary.data());
+
+    ofstream out(path(key, ".bin"), ios::binary);
+    out.write((const char*) &format, sizeof(format));
+    out.write(binary.data(), binary.size());
+}
+
+}
@@ -0,0 +1,58 @@
+#ifndef DISKCACHE_H
+#define DISKCACHE_H
+
+#include <atomic>
+#include <string>
+
+#include <QOpenGLFunctions>
+
+using namespace std;
+
+// Bump whenever the transpiler's output changes, so old GLSL isn't served from disk
+#define DISK_CACHE_VERSION 3
+
+namespace Wyatt {
+
+// Transpiled GLSL and linked program binaries kept between sessions in the per-user cache
+// directory. Everything in it belongs to the driver named in its manifest; opening it under a
+// different driver throws all of it away. Binaries are only saved and loaded when the context
+// supports glGetProgramBinary/glProgramBinary (GL 4.1, ES 3.0 or ARB_get_program_binary)
+class DiskCache {
+    public:
+        // Uses the context current on this thread to name the driver and find the binary entry points
+        void open(QOpenGLFunctions* gl);
+        bool is_open() const { return directory != ""; }
+
+        bool load_glsl(unsigned long long key, string& code);
+        void store_glsl(unsigned long long key, const string& code);
+
+        // Called before linking so the driver keeps the binary around for store_program()
+        void prepare_program(GLuint program);
+        // A linked program created from the saved binary, or 0
+        GLuint load_program(unsigned long long key);
+        void store_program(unsigned long long key, GLuint program);
+
+        unsigned int hits() const { return hitCount; }
+        unsigned int misses() const { return missCount; }
+
+    private:
+        typedef void (QOPENGLF_APIENTRYP GetProgramBinary)(GLuint, GLsizei, GLsizei*, GLenum*, void*);
+        typedef void (QOPENGLF_APIENTRYP ProgramBinary)(GLuint, GLenum, const void*, GLsizei);
+        typedef void (QOPENGLF_APIENTRYP ProgramParameteri)(GLuint, GLenum, GLint);
+
+        string directory = "";
+        QOpenGLFunctions* gl = nullptr;
+        GetProgramBinary getProgramBinary = nullptr;
+        ProgramBinary programBinary = nullptr;
+        ProgramParameteri programParameteri = nullptr;
+
+        // GLSL is looked up from the thread pool
+        atomic<unsigned int> hitCount{0};
+        atomic<unsigned int> missCount{0};
+
+        string path(unsigned long long key, const string& extension);
+};
+
+}
+
+#endif // DISKCACHE_H
@@ -0,0 +1,196 @@
+#include "framecapture.h"
+
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include <QDir>
+#include <QFileInfo>
+#include <QImage>
+#include <QOpenGLContext>
+
+#include "threadpool.h"
+#include "trace.h"
+
+#ifndef GL_PIXEL_PACK_BUFFER
+#define GL_PIXEL_PACK_BUFFER 0x88EB
+#endif
+#ifndef GL_STREAM_READ
+#define GL_STREAM_READ 0x88E1
+#endif
+#ifndef GL_MAP_READ_BIT
+#define GL_MAP_READ_BIT 0x0001
+#endif
+
+namespace Wyatt {
+
+FrameCapture::FrameCapture(LogWindow* logger, GLRegistry* registry): logger(logger), registry(registry) {}
+
+void FrameCapture::open(QOpenGLFunctions* gl) {
+    this->gl = gl;
+    mapBufferRange = nullptr;
+    unmapBuffer = nullptr;
+
+    // Without these, pixels are read straight into memory, which waits for the GPU
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context != nullptr) {
+        mapBufferRange = (MapBufferRange) context->getProcAddress("glMapBufferRange");
+        unmapBuffer = (UnmapBuffer) context->getProcAddress("glUnmapBuffer");
+    }
+}
+
+void FrameCapture::capture(GLuint framebuffer, int width, int height, const string& pattern) {
+    TRACE_SCOPE("gl", "capture");
+    string path = frame_path(pattern, counters[pattern]++);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+
+    if(mapBufferRange == nullptr || unmapBuffer == nullptr) {
+        auto pixels = make_shared<vector<unsigned char>>((size_t) width * height * 4);
+        gl->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, &(*pixels)[0]);
+        write(pixels, width, height, path);
+        return;
+    }
+
+    Readback readback;
+    readback.width = width;
+    readback.height = height;
+    readback.path = path;
+    readback.frame = frame;
+    if(idle.empty()) {
+        readback.pbo = registry->create(OBJECT_BUFFER);
+    } else {
+        readback.pbo = idle.back();
+        idle.pop_back();
+    }
+
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    gl->glBufferData(GL_PIXEL_PACK_BUFFER, (GLsizeiptr) width * height * 4, NULL, GL_STREAM_READ);
+    // With a pack buffer bound, this only queues the copy
+    gl->glReadPixels(0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, 0);
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    readbacks.push_back(readback);
+}
+
+void FrameCapture::end_frame() {
+    frame++;
+    while(!readbacks.empty() && readbacks.front().frame + LATENCY <= frame) {
+        finish(readbacks.front());
+        readbacks.pop_front();
+    }
+    reap(false);
+}
+
+void FrameCapture::flush() {
+    while(!readbacks.empty()) {
+        finish(readbacks.front());
+        readbacks.pop_front();
+    }
+    while(!writes.empty()) {
+        reap(true);
+    }
+}
+
+void FrameCapture::clear() {
+    for(auto it = readbacks.begin(); it != readbacks.end(); ++it) {
+        idle.push_back(it->pbo);
+    }
+    readbacks.clear();
+    for(auto it = idle.begin(); it != idle.end(); ++it) {
+        registry->release(OBJECT_BUFFER, *it);
+    }
+    idle.clear();
+    counters.clear();
+}
+
+void FrameCapture::finish(Readback& readback) {
+    size_t size = (size_t) readback.width * readback.height * 4;
+    auto pixels = make_shared<vector<unsigned char>>(size);
+
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, readback.pbo);
+    void* data = mapBufferRange(GL_PIXEL_PACK_BUFFER, 0, size, GL_MAP_READ_BIT);
+    if(data != nullptr) {
+        memcpy(&(*pixels)[0], data, size);
+        unmapBuffer(GL_PIXEL_PACK_BUFFER);
+    }
+    gl->glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+    idle.push_back(readback.pbo);
+
+    if(data == nullptr) {
+        logger->log("ERROR: Cannot read back " + readback.path);
+        return;
+    }
+    write(pixels, readback.width, readback.height, readback.path);
+}
+
+void FrameCapture::write(shared_ptr<vector<unsigned char>> pixels, int width, int height, const string& path) {
+    reap(false);
+    if(writes.size() >= maxQueued) {
+        if(!blocking) {
+            droppedCount++;
+            return;
+        }
+        reap(true);
+    }
+
+    writes.push_back(ThreadPool::shared().submit([pixels, width, height, path]() {
+        TRACE_SCOPE("capture", "write " + path);
+        QString file = QString::fromStdString(path);
+        QDir().mkpath(QFileInfo(file).absolutePath());
+        // GL's rows go bottom to top
+        QImage image(&(*pixels)[0], width, height, width * 4, QImage::Format_RGBA8888);
+        return image.mirrored().save(file)? string("") : path;
+    }));
+}
+
+void FrameCapture::reap(bool wait) {
+    while(!writes.empty()) {
+        future<string>& oldest = writes.front();
+        if(!wait && oldest.wait_for(chrono::seconds(0)) != future_status::ready) {
+            return;
+        }
+        string failed = oldest.get();
+        writes.pop_front();
+        if(failed != "") {
+            logger->log("ERROR: Cannot write capture " + failed);
+        } else {
+            writtenCount++;
+        }
+        // Only the oldest is waited for
+        wait = false;
+    }
+}
+
+string frame_path(const string& pattern, unsigned int index) {
+    string path = "";
+    for(size_t i = 0; i < pattern.size(); i++) {
+        if(pattern[i] != '%') {
+            path += pattern[i];
+            continue;
+        }
+        if(i + 1 < pattern.size() && pattern[i + 1] == '%') {
+            path += '%';
+            i++;
+            continue;
+        }
+        // Only %d with an optional zero-padded width; anything else is kept as it is
+        size_t end = i + 1;
+        while(end < pattern.size() && isdigit(pattern[end])) {
+            end++;
+        }
+        if(end < pattern.size() && pattern[end] == 'd') {
+            string number = to_string(index);
+            int width = end > i + 1? atoi(pattern.substr(i + 1, end - i - 1).c_str()) : 0;
+            if((int) number.size() < width) {
+                number = string(width - number.size(), '0') + number;
+            }
+            path += number;
+            i = end;
+        } else {
+            path += '%';
+        }
+    }
+    return path;
+}
+
+}
@@ -0,0 +1,85 @@
+#ifndef FRAMECAPTURE_H
+#define FRAMECAPTURE_H
+
+#include <deque>
+#include <future>
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+#include "logwindow.h"
+#include "glregistry.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// Reads framebuffers back into pixel buffer objects and writes them out as images on the thread
+// pool. A readback is only mapped LATENCY frames after it was started, by which time the GPU is done
+// with it, so capturing doesn't stall the frame. Writes are bounded by maxQueued: past that a
+// capture is dropped, or, when blocking, waits for the oldest write to finish
+class FrameCapture {
+    public:
+        FrameCapture(LogWindow*, GLRegistry*);
+
+        void open(QOpenGLFunctions* gl);
+
+        // Starts reading the colour buffer of framebuffer into the next file of pattern, whose %d
+        // (or %05d and so on) is replaced by how many frames were captured to it before
+        void capture(GLuint framebuffer, int width, int height, const string& pattern);
+        // Hands the readbacks old enough to the writers; called once per frame
+        void end_frame();
+        // Writes everything still being read back and waits for every write, e.g. before exiting
+        void flush();
+        // Drops the readbacks in flight and starts every pattern's numbering over, e.g. on reset;
+        // writes already queued still finish
+        void clear();
+
+        static const unsigned int LATENCY = 3;
+        unsigned int maxQueued = 8;
+        bool blocking = false;
+
+        unsigned int written() const { return writtenCount; }
+        unsigned int dropped() const { return droppedCount; }
+
+    private:
+        typedef void* (QOPENGLF_APIENTRYP MapBufferRange)(GLenum, GLintptr, GLsizeiptr, GLbitfield);
+        typedef GLboolean (QOPENGLF_APIENTRYP UnmapBuffer)(GLenum);
+
+        struct Readback {
+            GLuint pbo;
+            int width, height;
+            string path;
+            unsigned long long frame;
+        };
+
+        LogWindow* logger;
+        GLRegistry* registry;
+        QOpenGLFunctions* gl = nullptr;
+        MapBufferRange mapBufferRange = nullptr;
+        UnmapBuffer unmapBuffer = nullptr;
+
+        unsigned long long frame = 0;
+        deque<Readback> readbacks;
+        // Buffers of finished readbacks, to be used again
+        vector<GLuint> idle;
+        // Each write hands back the path it failed to write, or ""
+        deque<future<string>> writes;
+        map<string, unsigned int> counters;
+        unsigned int writtenCount = 0, droppedCount = 0;
+
+        void finish(Readback& readback);
+        void write(shared_ptr<vector<unsigned char>> pixels, int width, int height, const string& path);
+        // Collects the writes that are done, or waits for the oldest with wait
+        void reap(bool wait);
+};
+
+// pattern with its %d (or %05d and so on) replaced by index and %% by %
+string frame_path(const string& pattern, unsigned int index);
+
+}
+
+#endif // FRAMECAPTURE_H
@@ -0,0 +1,135 @@
+#include "glregistry.h"
+
+namespace Wyatt {
+
+void GLRegistry::open(QOpenGLFunctions* gl) {
+    this->gl = gl;
+}
+
+GLuint GLRegistry::create(GLObjectKind kind) {
+    GLuint name = take(kind, 0, 0, 0);
+    if(name == 0) {
+        if(kind == OBJECT_BUFFER) {
+            gl->glGenBuffers(1, &name);
+        } else
+        if(kind == OBJECT_FRAMEBUFFER) {
+            gl->glGenFramebuffers(1, &name);
+        } else
+        if(kind == OBJECT_PROGRAM) {
+            name = gl->glCreateProgram();
+        }
+    }
+    counts[kind]++;
+    return name;
+}
+
+GLuint GLRegistry::create_shader(GLenum type) {
+    counts[OBJECT_SHADER]++;
+    return gl->glCreateShader(type);
+}
+
+GLuint GLRegistry::create_texture(int width, int height, GLenum format, bool& reused) {
+    GLuint name = take(OBJECT_TEXTURE, width, height, format);
+    reused = name != 0;
+    if(name == 0) {
+        gl->glGenTextures(1, &name);
+    }
+    Shape shape;
+    shape.width = width;
+    shape.height = height;
+    shape.format = format;
+    textureShapes[name] = shape;
+    counts[OBJECT_TEXTURE]++;
+    return name;
+}
+
+void GLRegistry::adopt(GLObjectKind kind, GLuint name) {
+    if(name != 0) {
+        counts[kind]++;
+    }
+}
+
+void GLRegistry::release(GLObjectKind kind, GLuint name) {
+    if(name == 0) {
+        return;
+    }
+    counts[kind]--;
+
+    if(kind == OBJECT_SHADER || kind == OBJECT_PROGRAM) {
+        destroy(kind, name);
+        return;
+    }
+
+    Idle idle;
+    idle.kind = kind;
+    idle.name = name;
+    idle.width = 0;
+    idle.height = 0;
+    idle.format = 0;
+    idle.stale = false;
+    if(kind == OBJECT_TEXTURE) {
+        Shape shape = textureShapes[name];
+        idle.width = shape.width;
+        idle.height = shape.height;
+        idle.format = shape.format;
+        textureShapes.erase(name);
+    }
+    pool.push_back(idle);
+}
+
+void GLRegistry::discard(GLObjectKind kind, GLuint name) {
+    if(name == 0) {
+        return;
+    }
+    counts[kind]--;
+    if(kind == OBJECT_TEXTURE) {
+        textureShapes.erase(name);
+    }
+    destroy(kind, name);
+}
+
+// Textures have to match in size and format; any buffer or framebuffer will do
+GLuint GLRegistry::take(GLObjectKind kind, int width, int height, GLenum format) {
+    for(auto it = pool.begin(); it != pool.end(); ++it) {
+        if(it->kind == kind && it->width == width && it->height == height && it->format == format) {
+            GLuint name = it->name;
+            pool.erase(it);
+            return name;
+        }
+    }
+    return 0;
+}
+
+void GLRegistry::collect() {
+    for(auto it = pool.begin(); it != pool.end();) {
+        if(it->stale) {
+            destroy(it->kind, it->name);
+            it = pool.erase(it);
+        } else {
+            it->stale = true;
+            ++it;
+        }
+    }
+}
+
+void GLRegistry::destroy(GLObjectKind kind, GLuint name) {
+    switch(kind) {
+        case OBJECT_BUFFER: gl->glDeleteBuffers(1, &name); break;
+        case OBJECT_TEXTURE: gl->glDeleteTextures(1, &name); break;
+        case OBJECT_FRAMEBUFFER: gl->glDeleteFramebuffers(1, &name); break;
+        case OBJECT_SHADER: gl->glDeleteShader(name); break;
+        case OBJECT_PROGRAM: gl->glDeleteProgram(name); break;
+        default: break;
+    }
+}
+
+string GLRegistry::report() const {
+    return "GL objects: " + to_string(counts[OBJECT_BUFFER]) + " buffers, " +
+        to_string(counts[OBJECT_TEXTURE]) + " textures, " +
+        to_string(counts[OBJECT_FRAMEBUFFER]) + " framebuffers, " +
+        to_string(counts[OBJECT_PROGRAM]) + " programs, " +
+        to_string(counts[OBJECT_SHADER]) + " shaders, " +
+        to_string(pool.size()) + " pooled";
+}
+
+}
@@ -0,0 +1,73 @@
+#ifndef GLREGISTRY_H
+#define GLREGISTRY_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+using namespace std;
+
+namespace Wyatt {
+
+enum GLObjectKind {
+    OBJECT_BUFFER, OBJECT_TEXTURE, OBJECT_FRAMEBUFFER, OBJECT_SHADER, OBJECT_PROGRAM, OBJECT_KINDS
+};
+
+// Every GL object the interpreter creates goes through here, so none outlive the script that made
+// them unnoticed. Released buffers, textures and framebuffers aren't deleted right away but pooled:
+// the next run usually asks for the same ones again, and gets their names (and, for a texture of
+// the same size, its storage) back instead of new ones. collect() deletes what wasn't reused
+class GLRegistry {
+    public:
+        void open(QOpenGLFunctions* gl);
+
+        // A buffer, framebuffer or program
+        GLuint create(GLObjectKind kind);
+        GLuint create_shader(GLenum type);
+        // reused is set when the texture already has width x height storage of format, which can
+        // be filled with glTexSubImage2D instead of allocated again
+        GLuint create_texture(int width, int height, GLenum format, bool& reused);
+        // Counts an object created elsewhere, e.g. a program restored from a binary
+        void adopt(GLObjectKind kind, GLuint name);
+        // Buffers, textures and framebuffers go back to the pool; shaders and programs are deleted
+        void release(GLObjectKind kind, GLuint name);
+        // Deletes right away, for objects nothing will ask for again
+        void discard(GLObjectKind kind, GLuint name);
+
+        // Deletes what was released before the last collect() and hasn't been taken since
+        void collect();
+
+        unsigned int live(GLObjectKind kind) const { return counts[kind]; }
+        unsigned int pooled() const { return pool.size(); }
+        // The live objects of each kind, for the statistics
+        string report() const;
+
+    private:
+        struct Idle {
+            GLObjectKind kind;
+            GLuint name;
+            int width, height;
+            GLenum format;
+            // Already in the pool at the last collect()
+            bool stale;
+        };
+
+        QOpenGLFunctions* gl = nullptr;
+        unsigned int counts[OBJECT_KINDS] = {};
+        vector<Idle> pool;
+        // Storage of every live texture, so it can be matched again once pooled
+        struct Shape {
+            int width, height;
+            GLenum format;
+        };
+        map<GLuint, Shape> textureShapes;
+
+        GLuint take(GLObjectKind kind, int width, int height, GLenum format);
+        void destroy(GLObjectKind kind, GLuint name);
+};
+
+}
+
+#endif // GLREGISTRY_H
@@ -0,0 +1,890 @@
+#include "glsloptimizer.h"
+
+#include <cmath>
+#include <climits>
+
+GLSLOptimizer::GLSLOptimizer(GLSLTranspiler* transpiler): transpiler(transpiler)
+{
+
+}
+
+ShaderPair::ptr GLSLOptimizer::optimize(ShaderPair::ptr pair) {
+    ShaderPair::ptr result = make_shared<ShaderPair>();
+    result->name = pair->name;
+    result->vertex = copy(pair->vertex);
+    result->fragment = copy(pair->fragment);
+
+    Shader::ptr stages[] = {result->vertex, result->fragment};
+    for(Shader::ptr stage : stages) {
+        shader = stage;
+        for(auto it = shader->functions->begin(); it != shader->functions->end(); ++it) {
+            fold(it->second);
+            eliminate(it->second);
+        }
+    }
+
+    expand_layouts(result->vertex->outputs, "output");
+    expand_layouts(result->fragment->inputs, "input");
+    trim_varyings(result->vertex, result->fragment);
+
+    for(Shader::ptr stage : stages) {
+        shader = stage;
+        transpiler->begin(shader);
+        for(auto it = shader->functions->begin(); it != shader->functions->end(); ++it) {
+            // Trimming varyings can leave the locals that fed them unused
+            eliminate(it->second);
+            eliminate_subexpressions(it->second);
+        }
+    }
+
+    return result;
+}
+
+// Copies as much as the passes replace; statements and expressions are never modified in place,
+// only swapped for new ones, so everything below a function body can stay shared
+Shader::ptr GLSLOptimizer::copy(Shader::ptr original) {
+    Shader::ptr result = make_shared<Shader>(*original);
+    result->inputs = make_shared<ParamList>(*original->inputs);
+    result->outputs = make_shared<ParamList>(*original->outputs);
+    result->functions = make_shared<map<string, FuncDef::ptr>>();
+    for(auto it = original->functions->begin(); it != original->functions->end(); ++it) {
+        result->functions->insert(pair<string, FuncDef::ptr>(it->first, make_shared<FuncDef>(*it->second)));
+    }
+    return result;
+}
+
+void GLSLOptimizer::expand_layouts(ParamList::ptr params, const string& kind) {
+    vector<Decl::ptr> list;
+    for(auto it = params->list.begin(); it != params->list.end(); ++it) {
+        Decl::ptr decl = *it;
+        if(decl->datatype->name == kind && transpiler->layouts->find(decl->ident->name) != transpiler->layouts->end()) {
+            ProgramLayout::ptr layout = transpiler->layouts->at(decl->ident->name);
+            list.insert(list.end(), layout->attribs->begin(), layout->attribs->end());
+        } else {
+            list.push_back(decl);
+        }
+    }
+    params->list = list;
+}
+
+// The literal a variable declared as datatype holds when it's given value, or nullptr if it isn't a
+// scalar literal of that type. An int given to a float is converted, so it has to be a Float to
+// fold as one
+static Expr::ptr typed_literal(const string& datatype, Expr::ptr value) {
+    if(datatype == "float" && value->type == NODE_INT) {
+        return make_shared<Float>((float) static_pointer_cast<Int>(value)->value);
+    }
+    if((datatype == "float" && value->type == NODE_FLOAT) || (datatype == "int" && value->type == NODE_INT) || (datatype == "bool" && value->type == NODE_BOOL)) {
+        return value;
+    }
+    return nullptr;
+}
+
+void GLSLOptimizer::fold(FuncDef::ptr def) {
+    map<string, unsigned int> declared;
+    set<string> assigned;
+    declarations(def->stmts, declared, assigned);
+
+    constants.clear();
+    for(auto it = declared.begin(); it != declared.end(); ++it) {
+        if(it->second == 1 && assigned.find(it->first) == assigned.end()) {
+            constants[it->first] = nullptr;
+        }
+    }
+
+    // The shader's compile-time constants, unless a local or a parameter hides them
+    set<string> hidden;
+    for(auto it = def->params->list.begin(); it != def->params->list.end(); ++it) {
+        hidden.insert((*it)->ident->name);
+    }
+    for(auto it = shader->constants->begin(); it != shader->constants->end(); ++it) {
+        if(declared.count(it->first) || hidden.count(it->first)) {
+            continue;
+        }
+        Expr::ptr value = typed_literal(it->second->datatype->name, fold_expr(it->second->value));
+        if(value != nullptr) {
+            constants[it->first] = value;
+        }
+    }
+
+    def->stmts = fold_stmts(def->stmts);
+}
+
+Stmts::ptr GLSLOptimizer::fold_stmts(Stmts::ptr stmts) {
+    Stmts::ptr result = make_shared<Stmts>(nullptr);
+    vector<string> scoped;
+
+    for(auto it = stmts->list.begin(); it != stmts->list.end(); ++it) {
+        Stmt::ptr stmt = *it;
+        switch(stmt->type) {
+            case NODE_DECL:
+                {
+                    Decl::ptr decl = static_pointer_cast<Decl>(stmt);
+                    if(decl->value != nullptr) {
+                        Expr::ptr value = fold_expr(decl->value);
+                        if(value != decl->value) {
+                            decl = make_shared<Decl>(*decl);
+                            decl->value = value;
+                        }
+
+                        auto constant = constants.find(decl->ident->name);
+                        Expr::ptr literal = typed_literal(decl->datatype->name, value);
+                        if(constant != constants.end() && literal != nullptr && literal->type != NODE_BOOL) {
+                            constant->second = literal;
+                            scoped.push_back(decl->ident->name);
+                        }
+                    }
+                    result->list.push_back(decl);
+                    break;
+                }
+            case NODE_ASSIGN:
+                {
+                    Assign::ptr assign = static_pointer_cast<Assign>(stmt);
+                    Expr::ptr value = fold_expr(assign->value);
+                    if(value != assign->value) {
+                        assign = make_shared<Assign>(*assign);
+                        assign->value = value;
+                    }
+                    result->list.push_back(assign);
+                    break;
+                }
+            case NODE_IF:
+                {
+                    If::ptr ifStmt = fold_if(static_pointer_cast<If>(stmt));
+                    bool chained = ifStmt->elseIfBlocks && !ifStmt->elseIfBlocks->empty();
+                    if(ifStmt->condition->type == NODE_BOOL && !chained) {
+                        Stmts::ptr taken = static_pointer_cast<Bool>(ifStmt->condition)->value? ifStmt->block : ifStmt->elseBlock;
+                        if(taken == nullptr) {
+                            break;
+                        }
+
+                        // The block's declarations would clash with ours once it's inlined
+                        bool declares = false;
+                        for(auto jt = taken->list.begin(); jt != taken->list.end(); ++jt) {
+                            declares = declares || (*jt)->type == NODE_DECL;
+                        }
+                        if(!declares) {
+                            result->list.insert(result->list.end(), taken->list.begin(), taken->list.end());
+                            break;
+                        }
+                    }
+                    result->list.push_back(ifStmt);
+                    break;
+                }
+            default:
+                result->list.push_back(stmt);
+                break;
+        }
+    }
+
+    // Past the end of the block the name may mean something else again
+    for(auto it = scoped.begin(); it != scoped.end(); ++it) {
+        constants[*it] = nullptr;
+    }
+
+    return result;
+}
+
+If::ptr GLSLOptimizer::fold_if(If::ptr ifStmt) {
+    If::ptr result = make_shared<If>(*ifStmt);
+    result->condition = fold_expr(ifStmt->condition);
+    result->block = fold_stmts(ifStmt->block);
+    if(ifStmt->elseBlock != nullptr) {
+        result->elseBlock = fold_stmts(ifStmt->elseBlock);
+    }
+    if(ifStmt->elseIfBlocks) {
+        result->elseIfBlocks = make_shared<vector<If::ptr>>();
+        for(auto it = ifStmt->elseIfBlocks->begin(); it != ifStmt->elseIfBlocks->end(); ++it) {
+            result->elseIfBlocks->push_back(fold_if(*it));
+        }
+    }
+    return result;
+}
+
+Expr::ptr GLSLOptimizer::fold_expr(Expr::ptr expr) {
+    switch(expr->type) {
+        case NODE_IDENT:
+            {
+                auto constant = constants.find(static_pointer_cast<Ident>(expr)->name);
+                if(constant != constants.end() && constant->second != nullptr) {
+                    return constant->second;
+                }
+                return expr;
+            }
+        case NODE_UNARY:
+            {
+                Unary::ptr un = static_pointer_cast<Unary>(expr);
+                Expr::ptr rhs = fold_expr(un->rhs);
+                if(un->op == OP_MINUS && rhs->type == NODE_INT) {
+                    return make_shared<Int>(-static_pointer_cast<Int>(rhs)->value);
+                }
+                if(un->op == OP_MINUS && rhs->type == NODE_FLOAT) {
+                    return make_shared<Float>(-static_pointer_cast<Float>(rhs)->value);
+                }
+                if(un->op == OP_NOT && rhs->type == NODE_BOOL) {
+                    return make_shared<Bool>(!static_pointer_cast<Bool>(rhs)->value);
+                }
+                if(rhs == un->rhs) {
+                    return expr;
+                }
+                Unary::ptr result = make_shared<Unary>(*un);
+                result->rhs = rhs;
+                return result;
+            }
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                Expr::ptr lhs = fold_expr(bin->lhs);
+                Expr::ptr rhs = fold_expr(bin->rhs);
+                Expr::ptr folded = fold_binary(bin, lhs, rhs);
+                if(folded != nullptr) {
+                    return folded;
+                }
+                if(lhs == bin->lhs && rhs == bin->rhs) {
+                    return expr;
+                }
+                Binary::ptr result = make_shared<Binary>(*bin);
+                result->lhs = lhs;
+                result->rhs = rhs;
+                return result;
+            }
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                vector<Expr::ptr> parts;
+                bool changed = false;
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    parts.push_back(fold_expr(vec->get(i)));
+                    changed = changed || parts[i] != vec->get(i);
+                }
+                if(!changed) {
+                    return expr;
+                }
+                Expr::ptr result;
+                if(parts.size() == 2) {
+                    result = make_shared<Vector2>(parts[0], parts[1]);
+                } else if(parts.size() == 3) {
+                    result = make_shared<Vector3>(parts[0], parts[1], parts[2]);
+                } else {
+                    result = make_shared<Vector4>(parts[0], parts[1], parts[2], parts[3]);
+                }
+                result->parenthesized = expr->parenthesized;
+                return result;
+            }
+        case NODE_FUNCEXPR:
+            {
+                FuncExpr::ptr func = static_pointer_cast<FuncExpr>(expr);
+                ArgList::ptr args = make_shared<ArgList>(nullptr);
+                bool changed = false;
+                for(auto it = func->invoke->args->list.begin(); it != func->invoke->args->list.end(); ++it) {
+                    args->list.push_back(fold_expr(*it));
+                    changed = changed || args->list.back() != *it;
+                }
+                if(!changed) {
+                    return expr;
+                }
+                FuncExpr::ptr result = make_shared<FuncExpr>(make_shared<Invoke>(func->invoke->ident, args));
+                result->parenthesized = func->parenthesized;
+                return result;
+            }
+        default:
+            return expr;
+    }
+}
+
+// Only operands of the same type are folded. Mixed int and float operands are left to the compiler,
+// which converts the int implicitly where the GLSL version allows it
+Expr::ptr GLSLOptimizer::fold_binary(Binary::ptr bin, Expr::ptr lhs, Expr::ptr rhs) {
+    if(lhs->type == NODE_INT && rhs->type == NODE_INT) {
+        long long l = static_pointer_cast<Int>(lhs)->value;
+        long long r = static_pointer_cast<Int>(rhs)->value;
+        long long result;
+        switch(bin->op) {
+            case OP_PLUS: result = l + r; break;
+            case OP_MINUS: result = l - r; break;
+            case OP_MULT: result = l * r; break;
+            case OP_DIV:
+                // Rounding of negative quotients is up to the driver
+                if(r <= 0 || l < 0) {
+                    return nullptr;
+                }
+                result = l / r;
+                break;
+            case OP_LTHAN: return make_shared<Bool>(l < r);
+            case OP_GTHAN: return make_shared<Bool>(l > r);
+            case OP_LEQUAL: return make_shared<Bool>(l <= r);
+            case OP_GEQUAL: return make_shared<Bool>(l >= r);
+            case OP_EQUAL: return make_shared<Bool>(l == r);
+            case OP_NEQUAL: return make_shared<Bool>(l != r);
+            default: return nullptr;
+        }
+        if(result < INT_MIN || result > INT_MAX) {
+            return nullptr;
+        }
+        return make_shared<Int>(int(result));
+    }
+
+    if(lhs->type == NODE_FLOAT && rhs->type == NODE_FLOAT) {
+        float l = static_pointer_cast<Float>(lhs)->value;
+        float r = static_pointer_cast<Float>(rhs)->value;
+        float result;
+        switch(bin->op) {
+            case OP_PLUS: result = l + r; break;
+            case OP_MINUS: result = l - r; break;
+            case OP_MULT: result = l * r; break;
+            case OP_DIV:
+                if(r == 0.0f) {
+                    return nullptr;
+                }
+                result = l / r;
+                break;
+            case OP_LTHAN: return make_shared<Bool>(l < r);
+            case OP_GTHAN: return make_shared<Bool>(l > r);
+            default: return nullptr;
+        }
+        if(!std::isfinite(result)) {
+            return nullptr;
+        }
+        return make_shared<Float>(result);
+    }
+
+    if(lhs->type == NODE_BOOL && rhs->type == NODE_BOOL) {
+        bool l = static_pointer_cast<Bool>(lhs)->value;
+        bool r = static_pointer_cast<Bool>(rhs)->value;
+        switch(bin->op) {
+            case OP_AND: return make_shared<Bool>(l && r);
+            case OP_OR: return make_shared<Bool>(l || r);
+            case OP_EQUAL: return make_shared<Bool>(l == r);
+            case OP_NEQUAL: return make_shared<Bool>(l != r);
+            default: return nullptr;
+        }
+    }
+
+    return nullptr;
+}
+
+// Drops locals that are never read, along with the assignments to them, until nothing changes
+void GLSLOptimizer::eliminate(FuncDef::ptr def) {
+    map<string, unsigned int> declared;
+    set<string> assigned;
+    declarations(def->stmts, declared, assigned);
+
+    set<string> locals;
+    for(auto it = declared.begin(); it != declared.end(); ++it) {
+        locals.insert(it->first);
+    }
+
+    bool changed = true;
+    while(changed) {
+        changed = false;
+        set<string> live;
+        reads(def->stmts, live);
+        def->stmts = eliminate_stmts(def->stmts, live, locals, changed);
+    }
+}
+
+Stmts::ptr GLSLOptimizer::eliminate_stmts(Stmts::ptr stmts, const set<string>& live, const set<string>& locals, bool& changed) {
+    Stmts::ptr result = make_shared<Stmts>(nullptr);
+    for(auto it = stmts->list.begin(); it != stmts->list.end(); ++it) {
+        Stmt::ptr stmt = *it;
+        if(stmt->type == NODE_DECL) {
+            Decl::ptr decl = static_pointer_cast<Decl>(stmt);
+            string name = decl->ident->name;
+            if(locals.count(name) && !live.count(name) && (decl->value == nullptr || pure(decl->value))) {
+                changed = true;
+                continue;
+            }
+        } else
+        if(stmt->type == NODE_ASSIGN) {
+            Assign::ptr assign = static_pointer_cast<Assign>(stmt);
+            string name = target(assign->lhs);
+            if(locals.count(name) && !live.count(name) && pure(assign->value)) {
+                changed = true;
+                continue;
+            }
+        } else
+        if(stmt->type == NODE_IF) {
+            If::ptr ifStmt = make_shared<If>(*static_pointer_cast<If>(stmt));
+            ifStmt->block = eliminate_stmts(ifStmt->block, live, locals, changed);
+            if(ifStmt->elseBlock != nullptr) {
+                ifStmt->elseBlock = eliminate_stmts(ifStmt->elseBlock, live, locals, changed);
+            }
+            if(ifStmt->elseIfBlocks) {
+                auto elseIfs = ifStmt->elseIfBlocks;
+                ifStmt->elseIfBlocks = make_shared<vector<If::ptr>>();
+                for(auto jt = elseIfs->begin(); jt != elseIfs->end(); ++jt) {
+                    If::ptr elseIf = make_shared<If>(**jt);
+                    elseIf->block = eliminate_stmts(elseIf->block, live, locals, changed);
+                    ifStmt->elseIfBlocks->push_back(elseIf);
+                }
+            }
+            stmt = ifStmt;
+        }
+        result->list.push_back(stmt);
+    }
+    return result;
+}
+
+// Vertex outputs neither shader reads are dropped from both sides, along with the vertex
+// shader's writes to them. An output keeps its declaration if a write to it can't be removed
+// because its value has side effects
+void GLSLOptimizer::trim_varyings(Shader::ptr vertex, Shader::ptr fragment) {
+    set<string> read;
+    for(auto it = fragment->functions->begin(); it != fragment->functions->end(); ++it) {
+        reads(it->second->stmts, read);
+    }
+
+    ParamList::ptr inputs = make_shared<ParamList>(nullptr);
+    for(auto it = fragment->inputs->list.begin(); it != fragment->inputs->list.end(); ++it) {
+        if(read.find((*it)->ident->name) != read.end()) {
+            inputs->list.push_back(*it);
+        }
+    }
+    fragment->inputs = inputs;
+
+    for(auto it = vertex->functions->begin(); it != vertex->functions->end(); ++it) {
+        reads(it->second->stmts, read);
+    }
+
+    set<string> unused;
+    for(auto it = vertex->outputs->list.begin(); it != vertex->outputs->list.end(); ++it) {
+        string name = (*it)->ident->name;
+        if(name != "FinalPosition" && read.find(name) == read.end()) {
+            unused.insert(name);
+        }
+    }
+
+    shader = vertex;
+    set<string> live;
+    map<string, unsigned int> declared;
+    set<string> written;
+    for(auto it = vertex->functions->begin(); it != vertex->functions->end(); ++it) {
+        bool changed = false;
+        it->second->stmts = eliminate_stmts(it->second->stmts, live, unused, changed);
+        declarations(it->second->stmts, declared, written);
+    }
+
+    ParamList::ptr outputs = make_shared<ParamList>(nullptr);
+    for(auto it = vertex->outputs->list.begin(); it != vertex->outputs->list.end(); ++it) {
+        string name = (*it)->ident->name;
+        if(unused.find(name) == unused.end() || written.find(name) != written.end()) {
+            outputs->list.push_back(*it);
+        }
+    }
+    vertex->outputs = outputs;
+}
+
+// Within each run of declarations at the top of a function body, an expression that's
+// computed more than once is hoisted into a temporary. Anything else in between may change
+// the operands, so it ends the run
+void GLSLOptimizer::eliminate_subexpressions(FuncDef::ptr def) {
+    vector<Stmt::ptr>& list = def->stmts->list;
+    for(auto it = list.begin(); it != list.end(); ++it) {
+        if((*it)->type == NODE_DECL) {
+            Decl::ptr decl = static_pointer_cast<Decl>(*it);
+            transpiler->localtypes[decl->ident->name] = decl->datatype->name;
+        }
+    }
+
+    Stmts::ptr result = make_shared<Stmts>(nullptr);
+    unsigned int i = 0;
+    while(i < list.size()) {
+        if(list[i]->type != NODE_DECL) {
+            result->list.push_back(list[i++]);
+            continue;
+        }
+
+        vector<Decl::ptr> run;
+        while(i < list.size() && list[i]->type == NODE_DECL) {
+            run.push_back(static_pointer_cast<Decl>(list[i++]));
+        }
+
+        while(true) {
+            map<string, unsigned int> counts;
+            map<string, Binary::ptr> nodes;
+            for(auto it = run.begin(); it != run.end(); ++it) {
+                if((*it)->value != nullptr) {
+                    count_subexpressions((*it)->value, counts, nodes);
+                }
+            }
+
+            // The longest first, so that a repeated expression isn't split up by its parts
+            string best = "";
+            for(auto it = counts.begin(); it != counts.end(); ++it) {
+                if(it->second > 1 && it->first.size() > best.size()) {
+                    best = it->first;
+                }
+            }
+            if(best == "") {
+                break;
+            }
+
+            string type = type_of(nodes[best]);
+            Ident::ptr temporary = make_shared<Ident>("_cse" + to_string(temporaries++));
+            transpiler->localtypes[temporary->name] = type;
+            Binary::ptr value = make_shared<Binary>(*nodes[best]);
+            value->parenthesized = false;
+            Decl::ptr hoisted = make_shared<Decl>(make_shared<Ident>(type), temporary, value);
+
+            vector<Decl::ptr> rewritten;
+            for(auto it = run.begin(); it != run.end(); ++it) {
+                Decl::ptr decl = *it;
+                if(decl->value != nullptr) {
+                    Expr::ptr replaced = replace(decl->value, best, temporary);
+                    if(replaced != decl->value) {
+                        if(hoisted != nullptr) {
+                            rewritten.push_back(hoisted);
+                            hoisted = nullptr;
+                        }
+                        decl = make_shared<Decl>(*decl);
+                        decl->value = replaced;
+                    }
+                }
+                rewritten.push_back(decl);
+            }
+            run = rewritten;
+        }
+
+        result->list.insert(result->list.end(), run.begin(), run.end());
+    }
+
+    def->stmts = result;
+}
+
+void GLSLOptimizer::count_subexpressions(Expr::ptr expr, map<string, unsigned int>& counts, map<string, Binary::ptr>& nodes) {
+    switch(expr->type) {
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                count_subexpressions(bin->lhs, counts, nodes);
+                count_subexpressions(bin->rhs, counts, nodes);
+
+                string type = type_of(bin);
+                if(pure(bin) && (type == "float" || type == "vec2" || type == "vec3" || type == "vec4")) {
+                    string key = transpiler->eval_binary(bin);
+                    counts[key]++;
+                    if(nodes.find(key) == nodes.end()) {
+                        nodes[key] = bin;
+                    }
+                }
+                break;
+            }
+        case NODE_UNARY:
+            count_subexpressions(static_pointer_cast<Unary>(expr)->rhs, counts, nodes);
+            break;
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    count_subexpressions(vec->get(i), counts, nodes);
+                }
+                break;
+            }
+        case NODE_FUNCEXPR:
+            {
+                FuncExpr::ptr func = static_pointer_cast<FuncExpr>(expr);
+                for(auto it = func->invoke->args->list.begin(); it != func->invoke->args->list.end(); ++it) {
+                    count_subexpressions(*it, counts, nodes);
+                }
+                break;
+            }
+        default:
+            break;
+    }
+}
+
+Expr::ptr GLSLOptimizer::replace(Expr::ptr expr, const string& key, Ident::ptr temporary) {
+    switch(expr->type) {
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                if(transpiler->eval_binary(bin) == key) {
+                    return temporary;
+                }
+                Expr::ptr lhs = replace(bin->lhs, key, temporary);
+                Expr::ptr rhs = replace(bin->rhs, key, temporary);
+                if(lhs == bin->lhs && rhs == bin->rhs) {
+                    return expr;
+                }
+                Binary::ptr result = make_shared<Binary>(*bin);
+                result->lhs = lhs;
+                result->rhs = rhs;
+                return result;
+            }
+        case NODE_UNARY:
+            {
+                Unary::ptr un = static_pointer_cast<Unary>(expr);
+                Expr::ptr rhs = replace(un->rhs, key, temporary);
+                if(rhs == un->rhs) {
+                    return expr;
+                }
+                Unary::ptr result = make_shared<Unary>(*un);
+                result->rhs = rhs;
+                return result;
+            }
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                vector<Expr::ptr> parts;
+                bool changed = false;
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    parts.push_back(replace(vec->get(i), key, temporary));
+                    changed = changed || parts[i] != vec->get(i);
+                }
+                if(!changed) {
+                    return expr;
+                }
+                Expr::ptr result;
+                if(parts.size() == 2) {
+                    result = make_shared<Vector2>(parts[0], parts[1]);
+                } else if(parts.size() == 3) {
+                    result = make_shared<Vector3>(parts[0], parts[1], parts[2]);
+                } else {
+                    result = make_shared<Vector4>(parts[0], parts[1], parts[2], parts[3]);
+                }
+                result->parenthesized = expr->parenthesized;
+                return result;
+            }
+        case NODE_FUNCEXPR:
+            {
+                FuncExpr::ptr func = static_pointer_cast<FuncExpr>(expr);
+                ArgList::ptr args = make_shared<ArgList>(nullptr);
+                bool changed = false;
+                for(auto it = func->invoke->args->list.begin(); it != func->invoke->args->list.end(); ++it) {
+                    args->list.push_back(replace(*it, key, temporary));
+                    changed = changed || args->list.back() != *it;
+                }
+                if(!changed) {
+                    return expr;
+                }
+                FuncExpr::ptr result = make_shared<FuncExpr>(make_shared<Invoke>(func->invoke->ident, args));
+                result->parenthesized = func->parenthesized;
+                return result;
+            }
+        default:
+            return expr;
+    }
+}
+
+// The GLSL type of expr, or "" when it can't be told for certain
+string GLSLOptimizer::type_of(Expr::ptr expr) {
+    switch(expr->type) {
+        case NODE_INT:
+            return "int";
+        case NODE_FLOAT:
+            return "float";
+        case NODE_IDENT:
+            return transpiler->resolve_ident(static_pointer_cast<Ident>(expr));
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                int n = 0;
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    int size = type_to_size(type_of(vec->get(i)));
+                    if(size == 0) {
+                        return "";
+                    }
+                    n += size;
+                }
+                return n >= 2 && n <= 4? "vec" + to_string(n) : "";
+            }
+        case NODE_UNARY:
+            {
+                Unary::ptr un = static_pointer_cast<Unary>(expr);
+                string rtype = type_of(un->rhs);
+                if(un->op == OP_MINUS) {
+                    return rtype;
+                }
+                if(un->op == OP_ABS) {
+                    return rtype.compare(0, 3, "vec") == 0? "float" : rtype;
+                }
+                return "";
+            }
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                string ltype = type_of(bin->lhs);
+                string rtype = type_of(bin->rhs);
+                if(ltype == "" || rtype == "") {
+                    return "";
+                }
+                bool lvec = ltype.compare(0, 3, "vec") == 0;
+                bool rvec = rtype.compare(0, 3, "vec") == 0;
+                switch(bin->op) {
+                    case OP_PLUS: case OP_MINUS: case OP_MULT: case OP_DIV:
+                        if(ltype == rtype) return ltype;
+                        if(ltype == "float" && rvec) return rtype;
+                        if(lvec && rtype == "float") return ltype;
+                        return "";
+                    case OP_EXP:
+                        return lvec && ltype == rtype? "float" : "";
+                    case OP_MOD:
+                        return ltype == "vec3" && rtype == "vec3"? "vec3" : "";
+                    default:
+                        return "";
+                }
+            }
+        default:
+            return "";
+    }
+}
+
+// Calls to the shader's own functions may write its outputs; built-ins can't
+bool GLSLOptimizer::pure(Expr::ptr expr) {
+    switch(expr->type) {
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                return pure(bin->lhs) && pure(bin->rhs);
+            }
+        case NODE_UNARY:
+            return pure(static_pointer_cast<Unary>(expr)->rhs);
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    if(!pure(vec->get(i))) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        case NODE_FUNCEXPR:
+            {
+                FuncExpr::ptr func = static_pointer_cast<FuncExpr>(expr);
+                if(shader->functions->find(func->invoke->ident->name) != shader->functions->end()) {
+                    return false;
+                }
+                for(auto it = func->invoke->args->list.begin(); it != func->invoke->args->list.end(); ++it) {
+                    if(!pure(*it)) {
+                        return false;
+                    }
+                }
+                return true;
+            }
+        case NODE_INDEX:
+            {
+                Index::ptr index = static_pointer_cast<Index>(expr);
+                return pure(index->source) && pure(index->index);
+            }
+        default:
+            return true;
+    }
+}
+
+void GLSLOptimizer::reads(Expr::ptr expr, set<string>& names) {
+    switch(expr->type) {
+        case NODE_IDENT:
+            names.insert(static_pointer_cast<Ident>(expr)->name);
+            break;
+        case NODE_DOT:
+            names.insert(static_pointer_cast<Dot>(expr)->owner->name);
+            break;
+        case NODE_BINARY:
+            {
+                Binary::ptr bin = static_pointer_cast<Binary>(expr);
+                reads(bin->lhs, names);
+                reads(bin->rhs, names);
+                break;
+            }
+        case NODE_UNARY:
+            reads(static_pointer_cast<Unary>(expr)->rhs, names);
+            break;
+        case NODE_VECTOR2: case NODE_VECTOR3: case NODE_VECTOR4:
+            {
+                Vector::ptr vec = static_pointer_cast<Vector>(expr);
+                for(unsigned int i = 0; i < vec->size(); i++) {
+                    reads(vec->get(i), names);
+                }
+                break;
+            }
+        case NODE_FUNCEXPR:
+            {
+                FuncExpr::ptr func = static_pointer_cast<FuncExpr>(expr);
+                for(auto it = func->invoke->args->list.begin(); it != func->invoke->args->list.end(); ++it) {
+                    reads(*it, names);
+                }
+                break;
+            }
+        case NODE_INDEX:
+            {
+                Index::ptr index = static_pointer_cast<Index>(expr);
+                reads(index->source, names);
+                reads(index->index, names);
+                break;
+            }
+        default:
+            break;
+    }
+}
+
+void GLSLOptimizer::reads(Stmts::ptr stmts, set<string>& names) {
+    for(auto it = stmts->list.begin(); it != stmts->list.end(); ++it) {
+        Stmt::ptr stmt = *it;
+        if(stmt->type == NODE_DECL) {
+            Decl::ptr decl = static_pointer_cast<Decl>(stmt);
+            if(decl->value != nullptr) {
+                reads(decl->value, names);
+            }
+        } else
+        if(stmt->type == NODE_ASSIGN) {
+            Assign::ptr assign = static_pointer_cast<Assign>(stmt);
+            reads(assign->value, names);
+            if(assign->lhs->type == NODE_INDEX) {
+                reads(static_pointer_cast<Index>(assign->lhs)->index, names);
+            }
+        } else
+        if(stmt->type == NODE_IF) {
+            If::ptr ifStmt = static_pointer_cast<If>(stmt);
+            reads(ifStmt->condition, names);
+            reads(ifStmt->block, names);
+            if(ifStmt->elseBlock != nullptr) {
+                reads(ifStmt->elseBlock, names);
+            }
+            if(ifStmt->elseIfBlocks) {
+                for(auto jt = ifStmt->elseIfBlocks->begin(); jt != ifStmt->elseIfBlocks->end(); ++jt) {
+                    reads((*jt)->condition, names);
+                    reads((*jt)->block, names);
+                }
+            }
+        }
+    }
+}
+
+void GLSLOptimizer::declarations(Stmts::ptr stmts, map<string, unsigned int>& declared, set<string>& assigned) {
+    for(auto it = stmts->list.begin(); it != stmts->list.end(); ++it) {
+        Stmt::ptr stmt = *it;
+        if(stmt->type == NODE_DECL) {
+            declared[static_pointer_cast<Decl>(stmt)->ident->name]++;
+        } else
+        if(stmt->type == NODE_ASSIGN) {
+            assigned.insert(target(static_pointer_cast<Assign>(stmt)->lhs));
+        } else
+        if(stmt->type == NODE_IF) {
+            If::ptr ifStmt = static_pointer_cast<If>(stmt);
+            declarations(ifStmt->block, declared, assigned);
+            if(ifStmt->elseBlock != nullptr) {
+                declarations(ifStmt->elseBlock, declared, assigned);
+            }
+            if(ifStmt->elseIfBlocks) {
+                for(auto jt = ifStmt->elseIfBlocks->begin(); jt != ifStmt->elseIfBlocks->end(); ++jt) {
+                    declarations((*jt)->block, declared, assigned);
+                }
+            }
+        }
+    }
+}
+
+// The variable an assignment writes to, even if only part of it
+string GLSLOptimizer::target(Expr::ptr lhs) {
+    if(lhs->type == NODE_DOT) {
+        return static_pointer_cast<Dot>(lhs)->owner->name;
+    }
+    if(lhs->type == NODE_IDENT) {
+        return static_pointer_cast<Ident>(lhs)->name;
+    }
+    if(lhs->type == NODE_INDEX) {
+        return target(static_pointer_cast<Index>(lhs)->source);
+    }
+    return "";
+}
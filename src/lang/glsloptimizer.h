@@ -0,0 +1,58 @@
+#ifndef GLSLOPTIMIZER_H
+#define GLSLOPTIMIZER_H
+
+#include <map>
+#include <set>
+#include <string>
+
+#include "nodes.h"
+#include "glsltranspiler.h"
+
+using namespace std;
+
+// Rewrites a vertex/fragment pair before it's transpiled: constant folding (including the shader's
+// constants and locals that are only ever given a literal), dead code elimination, common
+// subexpression elimination within runs of declarations, and removal of varyings neither shader
+// reads. The parsed shaders are shared with the interpreter and the module cache, so the result
+// is a copy and nothing reachable from the input is modified
+class GLSLOptimizer
+{
+    public:
+        // Types are resolved through transpiler, which must already have its layouts
+        GLSLOptimizer(GLSLTranspiler*);
+        ShaderPair::ptr optimize(ShaderPair::ptr);
+
+    private:
+        GLSLTranspiler* transpiler;
+        Shader::ptr shader;
+        // Locals that are declared once with a literal and never assigned, by name
+        map<string, Expr::ptr> constants;
+        unsigned int temporaries = 0;
+
+        Shader::ptr copy(Shader::ptr);
+        void expand_layouts(ParamList::ptr, const string&);
+
+        void fold(FuncDef::ptr);
+        Stmts::ptr fold_stmts(Stmts::ptr);
+        If::ptr fold_if(If::ptr);
+        Expr::ptr fold_expr(Expr::ptr);
+        Expr::ptr fold_binary(Binary::ptr, Expr::ptr, Expr::ptr);
+
+        void eliminate(FuncDef::ptr);
+        Stmts::ptr eliminate_stmts(Stmts::ptr, const set<string>& live, const set<string>& locals, bool& changed);
+
+        void trim_varyings(Shader::ptr vertex, Shader::ptr fragment);
+
+        void eliminate_subexpressions(FuncDef::ptr);
+        void count_subexpressions(Expr::ptr, map<string, unsigned int>&, map<string, Binary::ptr>&);
+        Expr::ptr replace(Expr::ptr, const string& key, Ident::ptr);
+        string type_of(Expr::ptr);
+
+        bool pure(Expr::ptr);
+        void reads(Expr::ptr, set<string>&);
+        void reads(Stmts::ptr, set<string>&);
+        void declarations(Stmts::ptr, map<string, unsigned int>& declared, set<string>& assigned);
+        string target(Expr::ptr);
+};
+
+#endif // GLSLOPTIMIZER_H
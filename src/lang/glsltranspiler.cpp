@@ -1,17 +1,50 @@
 #include "glsltranspiler.h"
 
+#include <iomanip>
+#include <locale>
+#include <sstream>
+
 GLSLTranspiler::GLSLTranspiler(LogWindow* logger): logger(logger)
 {
 
 }
 
-//TODO: Organize better
-string GLSLTranspiler::transpile(Shader::ptr shader) {
+// Points type resolution at shader, without emitting anything
+void GLSLTranspiler::begin(Shader::ptr shader) {
     this->shader = shader;
+    localtypes.clear();
+    errors = 0;
+
+    inputs.clear();
+    for(auto it = shader->inputs->list.begin(); it != shader->inputs->list.end(); ++it) {
+        Decl::ptr decl = *it;
+        if(decl->datatype->name == "input" && layouts->find(decl->ident->name) != layouts->end()) {
+            ProgramLayout::ptr layout = layouts->at(decl->ident->name);
+            inputs.insert(inputs.end(), layout->attribs->begin(), layout->attribs->end());
+        } else {
+            inputs.push_back(decl);
+        }
+    }
+}
+
+//TODO: Organize better
+string GLSLTranspiler::transpile(Shader::ptr shader, bool fragment) {
+    begin(shader);
 
     string source = "#version 130\n";
+    for(auto it = shader->uniforms->begin(); it != shader->uniforms->end(); ++it) {
+        if(it->second == "uniform") {
+            source += "#extension GL_ARB_uniform_buffer_object : require\n";
+            break;
+        }
+    }
+    // A fragment shader with several outputs writes each to the draw buffer of the same index,
+    // i.e. the targets of a draw statement in the order they're listed
+    bool located = fragment && shader->outputs->list.size() > 1;
+    if(located) {
+        source += "#extension GL_ARB_explicit_attrib_location : require\n";
+    }
 
-    vector<Decl::ptr> new_inputs;
     for(auto it = shader->inputs->list.begin(); it != shader->inputs->list.end(); ++it) {
         Decl::ptr decl = *it;
         if(decl->datatype->name == "input") {
@@ -20,16 +53,15 @@ string GLSLTranspiler::transpile(Shader::ptr shader) {
                 for(auto jt = layout->attribs->begin(); jt != layout->attribs->end(); ++jt) {
                     Decl::ptr attrib = *jt;
                     source += "in " + attrib->datatype->name + " " + attrib->ident->name + ";\n";
-                    new_inputs.push_back(attrib);
                 }
             } else {
                 logger->log(decl, "ERROR", "Layout of name " + decl->ident->name + " does not exist");
+                errors++;
             }
         } else {
             source += "in " + decl->datatype->name + " " + decl->ident->name + ";\n";
         }
     }
-    shader->inputs->list.insert(shader->inputs->list.end(), new_inputs.begin(), new_inputs.end());
 
     source += "\n";
 
@@ -38,12 +70,32 @@ string GLSLTranspiler::transpile(Shader::ptr shader) {
         if(type == "texture2D") {
             type = "sampler2D";
         }
+        if(type == "uniform") {
+            // No instance name, so the members are used as plain uniforms
+            auto layout = layouts->find(it->first);
+            if(layout == layouts->end() || !layout->second->uniform) {
+                logger->log(shader, "ERROR", "Uniform block of name " + it->first + " does not exist");
+                errors++;
+                continue;
+            }
+            source += "layout(std140) uniform " + it->first + " {\n";
+            for(auto jt = layout->second->attribs->begin(); jt != layout->second->attribs->end(); ++jt) {
+                source += "    " + (*jt)->datatype->name + " " + (*jt)->ident->name + ";\n";
+            }
+            source += "};\n";
+            continue;
+        }
         source += "uniform " + type + " " + it->first + ";\n";
     }
 
+    for(auto it = shader->constants->begin(); it != shader->constants->end(); ++it) {
+        Decl::ptr decl = it->second;
+        source += "const " + decl->datatype->name + " " + it->first + " = " + eval_expr(decl->value) + ";\n";
+    }
+
     source += "\n";
 
-    vector<Decl::ptr> new_outputs;
+    unsigned int location = 0;
     for(auto it = shader->outputs->list.begin(); it != shader->outputs->list.end(); ++it) {
         Decl::ptr decl = *it;
         if(decl->ident->name == "FinalPosition") {
@@ -55,16 +107,18 @@ string GLSLTranspiler::transpile(Shader::ptr shader) {
                 for(auto jt = layout->attribs->begin(); jt != layout->attribs->end(); ++jt) {
                     Decl::ptr attrib = *jt;
                     source += "out " + attrib->datatype->name + " " + attrib->ident->name + ";\n";
-                    new_outputs.push_back(attrib);
                 }
             } else {
                 logger->log(decl, "ERROR", "Layout of name " + decl->ident->name + " does not exist");
+                errors++;
             }
         } else {
+            if(located) {
+                source += "layout(location = " + to_string(location++) + ") ";
+            }
             source += "out " + decl->datatype->name + " " + decl->ident->name + ";\n";
         }
     }
-    shader->outputs->list.insert(shader->outputs->list.end(), new_outputs.begin(), new_outputs.end());
 
     source += "\n";
 
@@ -88,6 +142,18 @@ string GLSLTranspiler::transpile(Shader::ptr shader) {
     return source;
 }
 
+// Enough digits for the driver to get back the same float, and always a float in GLSL's eyes
+string float_literal(float f) {
+    ostringstream ss;
+    ss.imbue(locale::classic());
+    ss << setprecision(9) << f;
+    string literal = ss.str();
+    if(literal.find_first_of(".e") == string::npos) {
+        literal += ".0";
+    }
+    return literal;
+}
+
 int type_to_size(string type) {
     if(type == "int" || type == "float") {
         return 1;
@@ -112,7 +178,19 @@ string GLSLTranspiler::resolve_ident(Ident::ptr ident) {
     if(shader->uniforms->find(name) != shader->uniforms->end()) {
         return shader->uniforms->at(name);
     } else {
-        for(auto jt = shader->inputs->list.begin(); jt != shader->inputs->list.end(); ++jt) {
+        for(auto it = shader->uniforms->begin(); it != shader->uniforms->end(); ++it) {
+            auto layout = layouts->find(it->first);
+            if(it->second != "uniform" || layout == layouts->end()) {
+                continue;
+            }
+            for(auto jt = layout->second->attribs->begin(); jt != layout->second->attribs->end(); ++jt) {
+                if((*jt)->ident->name == name) {
+                    return (*jt)->datatype->name;
+                }
+            }
+        }
+
+        for(auto jt = inputs.begin(); jt != inputs.end(); ++jt) {
             Decl::ptr decl = *jt;
             if(decl->ident->name == name) {
                 return decl->datatype->name;
@@ -307,7 +385,10 @@ string GLSLTranspiler::eval_expr(Expr::ptr expr) {
             output = to_string(static_pointer_cast<Int>(expr)->value);
             break;
         case NODE_FLOAT:
-            output = to_string(static_pointer_cast<Float>(expr)->value);
+            output = float_literal(static_pointer_cast<Float>(expr)->value);
+            break;
+        case NODE_BOOL:
+            output = static_pointer_cast<Bool>(expr)->value? "true" : "false";
             break;
         case NODE_IDENT:
             {
@@ -488,6 +569,7 @@ string GLSLTranspiler::eval_stmt(Stmt::ptr stmt) {
         case NODE_PRINT:
             {
                 logger->log(stmt, "ERROR", "Printing not allowed from inside shaders");
+                errors++;
                 return "";
             }
         default:
@@ -9,11 +9,15 @@
 
 using namespace std;
 
+string float_literal(float);
+int type_to_size(string);
+
 class GLSLTranspiler
 {
     public:
         GLSLTranspiler(LogWindow*);
-        string transpile(Shader::ptr);
+        void begin(Shader::ptr);
+        string transpile(Shader::ptr, bool fragment = false);
         
         LogWindow* logger;
         Shader::ptr shader;
@@ -31,6 +35,10 @@ class GLSLTranspiler
         string resolve_unary(Unary::ptr);
 
         map<string, string> localtypes;
+        // The shader's inputs with every layout expanded into its attributes
+        vector<Decl::ptr> inputs;
+        // Errors logged by the last transpile()
+        unsigned int errors = 0;
 };
 
 #endif // GLSLTRANSPILER_H
@@ -1,5 +1,7 @@
 #include "helper.h"
 
+#include <sys/stat.h>
+
 string str_from_file(string filename) {
     string text = "";
     ifstream file;
@@ -26,3 +28,21 @@ bool file_exists(string filename) {
     return exists;
 }
 
+long long file_mtime(string filename) {
+    struct stat info;
+    if(stat(filename.c_str(), &info) != 0) {
+        return -1;
+    }
+    return info.st_mtime;
+}
+
+// FNV-1a, chained through seed so several fields can be folded into one hash
+unsigned long long hash_bytes(const void* data, size_t size, unsigned long long seed) {
+    const unsigned char* bytes = (const unsigned char*) data;
+    unsigned long long hash = seed;
+    for(size_t i = 0; i < size; i++) {
+        hash ^= bytes[i];
+        hash *= 1099511628211ULL;
+    }
+    return hash;
+}
@@ -7,7 +7,12 @@
 
 using namespace std;
 
+#define HASH_SEED 14695981039346656037ULL
+
 string str_from_file(string); 
 bool file_exists(string);
+// Last modification time in seconds, or -1 if the file can't be found
+long long file_mtime(string);
+unsigned long long hash_bytes(const void*, size_t, unsigned long long seed = HASH_SEED);
 
 #endif
@@ -3,9 +3,18 @@
 #include <algorithm>
 #include <memory>
 
+#include <QOpenGLContext>
+
 #define STB_IMAGE_IMPLEMENTATION
 #include "stb_image.h"
 
+#ifndef GL_TEXTURE_BASE_LEVEL
+#define GL_TEXTURE_BASE_LEVEL 0x813C
+#endif
+#ifndef GL_TEXTURE_MAX_LEVEL
+#define GL_TEXTURE_MAX_LEVEL 0x813D
+#endif
+
 int resolve_int(Expr::ptr expr) {
     return static_pointer_cast<Int>(expr)->value;
 }
@@ -35,9 +44,8 @@ float resolve_scalar(Expr::ptr expr) {
 
 #define LOOP_TIMEOUT 5
 
-Wyatt::Interpreter::Interpreter(LogWindow* logger): scanner(&line, &column), parser(scanner, logger, &line, &column, &imports, &globals, &functions, &layouts, &shaders), logger(logger) {
-    globalScope = make_shared<Scope>("global", logger, &workingDir);
-    transpiler = new GLSLTranspiler(logger);
+Wyatt::Interpreter::Interpreter(LogWindow* logger): frameCapture(logger, &registry), logger(logger), uniformBlocks(logger, &registry), textures(logger, &textureCache, &registry), renderTargets(&registry) {
+    globalScope = make_shared<Scope>("global", logger, &workingDir, &textures);
 
     init_invoke = make_shared<Invoke>(make_shared<Ident>("init"), make_shared<ArgList>(nullptr));
     loop_invoke = make_shared<Invoke>(make_shared<Ident>("loop"), make_shared<ArgList>(nullptr));
@@ -53,14 +61,141 @@ void Wyatt::Interpreter::reset() {
 
     globalScope->clear();
     while(!functionScopeStack.empty()) functionScopeStack.pop();
+    constantLists.clear();
+    failedPrograms.clear();
+    uniformOwners.clear();
 
     current_program_name = "";
     current_program = nullptr;
+    boundProgram = 0;
+    boundTextures.clear();
+    activeUnit = -1;
+    uniformBlocks.clear();
+    textures.clear();
+    release_objects(true);
+    renderTargets.clear();
+    // The last few frames captured are still being read back
+    frameCapture.flush();
+    frameCapture.clear();
+    registry.collect();
+    profiler.clear();
     init = nullptr;
     loop = nullptr;
+}
 
-    line = 1;
-    column = 1;
+// Takes over a script built by Script::build(), possibly on another thread
+void Wyatt::Interpreter::load(Script::ptr script) {
+    reset();
+    status = script->status;
+    imports = script->imports;
+    globals = script->globals;
+    functions = script->functions;
+    layouts = script->layouts;
+    shaders = script->shaders;
+}
+
+// Swaps in an edited script without re-running init(). Function bodies are always replaced,
+// shaders are relinked only when their text changed, and globals keep their current value unless
+// their declaration changed. Returns false, leaving everything untouched, when the edit can't be
+// applied in place: init() itself, a layout, or a buffer or texture declaration changed
+bool Wyatt::Interpreter::hot_swap(Script::ptr script) {
+    if(status != 0 || script->status != 0 || !init) {
+        return false;
+    }
+    TRACE_SCOPE("compile", "hot_swap");
+
+    auto newInit = script->functions.find("init");
+    if(newInit == script->functions.end() || newInit->second->digest != init->digest) {
+        return false;
+    }
+
+    if(script->layouts.size() != layouts.size()) {
+        return false;
+    }
+    for(auto it = script->layouts.begin(); it != script->layouts.end(); ++it) {
+        auto old = layouts.find(it->first);
+        if(old == layouts.end() || old->second->digest != it->second->digest) {
+            return false;
+        }
+    }
+
+    map<string, unsigned long long> oldGlobals;
+    for(auto it = globals.begin(); it != globals.end(); ++it) {
+        oldGlobals[(*it)->ident->name] = (*it)->digest;
+    }
+    vector<Decl::ptr> changedGlobals;
+    for(auto it = script->globals.begin(); it != script->globals.end(); ++it) {
+        Decl::ptr decl = *it;
+        auto old = oldGlobals.find(decl->ident->name);
+        if(old != oldGlobals.end() && old->second == decl->digest) {
+            continue;
+        }
+        string type = decl->datatype->name;
+        if(type == "buffer" || type == "texture2D" || type == "pingpong") {
+            return false;
+        }
+        changedGlobals.push_back(decl);
+    }
+
+    vector<string> changedShaders;
+    for(auto it = script->shaders.begin(); it != script->shaders.end(); ++it) {
+        auto old = shaders.find(it->first);
+        shared_ptr<ShaderPair> pair = it->second;
+        if(old == shaders.end() ||
+           !old->second->vertex || !pair->vertex || old->second->vertex->digest != pair->vertex->digest ||
+           !old->second->fragment || !pair->fragment || old->second->fragment->digest != pair->fragment->digest) {
+            changedShaders.push_back(it->first);
+        }
+    }
+
+    // The built-in constants execute_init() put in front of the globals stay declared
+    vector<Decl::ptr> builtins;
+    for(auto it = globals.begin(); it != globals.end() && (*it)->digest == 0; ++it) {
+        builtins.push_back(*it);
+    }
+
+    imports = script->imports;
+    globals = builtins;
+    globals.insert(globals.end(), script->globals.begin(), script->globals.end());
+    functions = script->functions;
+    layouts = script->layouts;
+    shaders = script->shaders;
+    // The literals of the old function bodies are gone
+    constantLists.clear();
+
+    init = functions["init"];
+    loop = functions["loop"];
+    if(loop == nullptr) {
+        logger->log("WARNING: No loop function detected");
+    }
+    CodeEditor::autocomplete_functions = functions;
+
+    // Shaders the script hasn't used yet stay deferred
+    vector<string> relink, defer;
+    for(auto it = changedShaders.begin(); it != changedShaders.end(); ++it) {
+        Expr::ptr program = globalScope->get(*it);
+        if(program != nullptr && program->type == NODE_PROGRAM && !static_pointer_cast<Program>(program)->deferred) {
+            relink.push_back(*it);
+        } else {
+            defer.push_back(*it);
+        }
+    }
+    link_programs(relink);
+    defer_programs(defer);
+    release_programs();
+    current_program_name = "";
+    current_program = nullptr;
+    boundProgram = 0;
+
+    for(auto it = changedGlobals.begin(); it != changedGlobals.end(); ++it) {
+        globalScope->forget((*it)->ident->name);
+        eval_stmt(*it);
+    }
+    // Buffers and render targets the redeclared globals replaced
+    release_objects();
+
+    profiler.clear();
+    return true;
 }
 
 string Wyatt::Interpreter::print_expr(Expr::ptr expr) {
@@ -530,12 +665,53 @@ Expr::ptr Wyatt::Interpreter::invoke(Invoke::ptr invoke) {
         }
     }
 
+    // Links the given programs (every program, without arguments) now rather than on first use,
+    // together so their compiles overlap. A program with constants picked gets that permutation
+    if(name == "prewarm") {
+        vector<Program::ptr> programs;
+        for(auto it = invoke->args->list.begin(); it != invoke->args->list.end(); ++it) {
+            Expr::ptr arg = eval_expr(*it);
+            if(arg == nullptr || arg->type != NODE_PROGRAM) {
+                logger->log(*it, "ERROR", "prewarm expects programs");
+                return nullptr;
+            }
+            programs.push_back(static_pointer_cast<Program>(arg));
+        }
+        if(invoke->args->list.empty()) {
+            for(auto it = shaders.begin(); it != shaders.end(); ++it) {
+                Expr::ptr program = globalScope->get(it->first);
+                if(program != nullptr && program->type == NODE_PROGRAM) {
+                    programs.push_back(static_pointer_cast<Program>(program));
+                }
+            }
+        }
+
+        TRACE_SCOPE("compile", "prewarm");
+        vector<string> names;
+        for(auto it = programs.begin(); it != programs.end(); ++it) {
+            Program::ptr program = *it;
+            if(!program->selection.empty()) {
+                permutation(program);
+            } else if(program->deferred) {
+                names.push_back(program->vertSource->name);
+            }
+        }
+        link_programs(names);
+        return nullptr;
+    }
+
+    // Blocks until every image assigned to a texture so far is decoded
+    if(name == "wait_textures") {
+        textures.wait_all();
+        return nullptr;
+    }
+
     if(functions.find(name) != functions.end()) {
         def = functions[name];
     }
 
     if(def != nullptr) {
-        ScopeList::ptr localScope = make_shared<ScopeList>(name, logger, &workingDir);
+        ScopeList::ptr localScope = make_shared<ScopeList>(name, logger, &workingDir, &textures);
         unsigned int nParams = def->params->list.size();
         unsigned int nArgs = invoke->args->list.size();
 
@@ -556,9 +732,19 @@ Expr::ptr Wyatt::Interpreter::invoke(Invoke::ptr invoke) {
             }
         }
 
+        TRACE_SCOPE("script", def->ident->name);
+        bool profiled = profiler.enabled;
+        if(profiled) {
+            profiler.enter_function(name, def->source == "");
+        }
+
         functionScopeStack.push(localScope);
         Expr::ptr retValue = execute_stmts(def->stmts);
         functionScopeStack.pop();
+
+        if(profiled) {
+            profiler.exit_function();
+        }
         return retValue;
     } else {
         logger->log(invoke, "ERROR", "Function " + name + " does not exist");
@@ -620,6 +806,8 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
                 get_variable(value, ident->name);
                 if(value == nullptr) {
                     logger->log(ident, "ERROR", "Variable " + ident->name + " does not exist");
+                } else if(value == timeValue || value == deltaValue) {
+                    dynamicFrame = true;
                 }
 
                 return value;
@@ -637,11 +825,17 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
                 if(owner->type == NODE_PROGRAM) {
                     Program::ptr program = static_pointer_cast<Program>(owner);
 
-                    bool reupload = false;
-                    if(current_program_name != dot->owner->name) {
+                    Decl::ptr constant = shader_constant(program, dot->name);
+                    if(constant != nullptr) {
+                        auto picked = program->selection.find(dot->name);
+                        return picked != program->selection.end()? picked->second : eval_expr(constant->value);
+                    }
+                    program = linked(program);
+
+                    if(current_program_name != dot->owner->name || stalePermutation) {
                         current_program_name = dot->owner->name;
-                        current_program = program;
-                        reupload = true;
+                        current_program = program != nullptr? specialize(program) : nullptr;
+                        stalePermutation = false;
                     }
 
                     if(current_program == nullptr) {
@@ -649,9 +843,7 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
                         return nullptr;
                     }
 
-                    if(reupload) {
-                        gl->glUseProgram(current_program->handle);
-                    }
+                    use_program(current_program->handle);
 
                     Shader::ptr src = current_program->vertSource;
                     string type = "";
@@ -715,6 +907,19 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
                 } else
                 if(owner->type == NODE_TEXTURE) {
                     Texture::ptr texture = static_pointer_cast<Texture>(owner);
+                    if(dot->name == "mipmaps") {
+                        return make_shared<Bool>(texture->mipmaps);
+                    }
+                    if(dot->name == "filter") {
+                        return make_shared<String>(texture->filter);
+                    }
+                    if(dot->name == "wrap") {
+                        return make_shared<String>(texture->wrap);
+                    }
+                    // The size isn't known until the image is decoded
+                    if(texture->loading) {
+                        textures.resolve(texture, true);
+                    }
                     if(dot->name == "width") {
                         return make_shared<Int>(texture->width);
                     }
@@ -726,11 +931,28 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
                     }
                     return nullptr;
                 } else
+                if(owner->type == NODE_PINGPONG) {
+                    PingPong::ptr pingpong = static_pointer_cast<PingPong>(owner);
+                    if(dot->name == "read") {
+                        return pingpong->read();
+                    }
+                    if(dot->name == "write") {
+                        return pingpong->write();
+                    }
+                    if(dot->name == "width") {
+                        return make_shared<Int>(pingpong->read()->width);
+                    }
+                    if(dot->name == "height") {
+                        return make_shared<Int>(pingpong->read()->height);
+                    }
+                    return nullptr;
+                } else
                 if(owner->type == NODE_BUFFER) {
                     Buffer::ptr buffer = static_pointer_cast<Buffer>(owner);
                     if(buffer->data.find(dot->name) != buffer->data.end()) {
                         vector<float> attrib_data = buffer->data[dot->name];
                         List::ptr list = make_shared<List>(nullptr);
+                        list->literal = false;
                         int size = buffer->layout->attributes[dot->name];
                         for(unsigned int i = 0 ; i < attrib_data.size(); i += size) {
                             if(size == 1) {
@@ -768,24 +990,35 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
         case NODE_LIST:
             {
                 List::ptr list = static_pointer_cast<List>(node);
-                if(list->list.size() == 0 && list->literal) {
-                    List::ptr newlist = make_shared<List>(nullptr);
-                    newlist->literal = false;
-                    newlist->first_line = list->first_line;
-                    newlist->last_line = list->last_line;
-                    return newlist;
-                } else {
-                    if(!list->evaluated) {
-                        //FIXME: This severly impacts performance
-                        for(unsigned int i = 0; i < list->list.size(); i++) {
-                            list->list[i] = eval_expr(list->list[i]);
-                        }
-                        list->evaluated = true;
-                    }
+                if(!list->literal) {
                     return list;
-               }
+                }
 
-                break;
+                // A literal of constants comes out the same every time, so the list it made last time
+                // is handed out again as long as nothing kept hold of it or changed it
+                auto cached = constantLists.find(list);
+                if(cached != constantLists.end() && cached->second.use_count() == 1 && cached->second->list == list->list) {
+                    return cached->second;
+                }
+
+                // Literals belong to the parsed tree, which imports share through the module cache,
+                // so the values land in a fresh list instead of replacing the literal's elements
+                List::ptr newlist = make_shared<List>(nullptr);
+                newlist->literal = false;
+                newlist->evaluated = true;
+                newlist->first_line = list->first_line;
+                newlist->last_line = list->last_line;
+                newlist->list.reserve(list->list.size());
+                bool constant = true;
+                for(unsigned int i = 0; i < list->list.size(); i++) {
+                    NodeType type = list->list[i]->type;
+                    constant = constant && (type == NODE_BOOL || type == NODE_INT || type == NODE_FLOAT || type == NODE_STRING);
+                    newlist->list.push_back(eval_expr(list->list[i]));
+                }
+                if(constant) {
+                    constantLists[list] = newlist;
+                }
+                return newlist;
             }
 
         case NODE_BUFFER:
@@ -794,6 +1027,9 @@ Expr::ptr Wyatt::Interpreter::eval_expr(Expr::ptr node) {
         case NODE_TEXTURE:
             return node;
 
+        case NODE_PINGPONG:
+            return node;
+
         case NODE_UPLOADLIST:
             return node;
 
@@ -1141,22 +1377,28 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                     scope = functionScopeStack.top()->current();
                 }
 
+                Expr::ptr value = decl->value;
                 if(decl->datatype->name == "buffer") {
                     Buffer::ptr buf = make_shared<Buffer>();
                     buf->layout = new Layout();
 
-                    gl->glGenBuffers(1, &(buf->handle));
-                    gl->glGenBuffers(1, &(buf->indexHandle));
+                    buf->handle = registry.create(OBJECT_BUFFER);
+                    own(buf, OBJECT_BUFFER, buf->handle);
 
-                    decl->value = buf;
+                    value = buf;
                 }
                 if(decl->datatype->name == "texture2D") {
-                    if(decl->value == nullptr) {
-                        decl->value = make_shared<Texture>();
+                    if(value == nullptr) {
+                        value = make_shared<Texture>();
+                    }
+                }
+                if(decl->datatype->name == "pingpong") {
+                    if(value == nullptr) {
+                        value = make_shared<PingPong>();
                     }
                 }
 
-                scope->declare(decl, decl->ident, decl->datatype->name, eval_expr(decl->value));
+                scope->declare(decl, decl->ident, decl->datatype->name, eval_expr(value));
 
                 return nullptr;
             }
@@ -1172,6 +1414,7 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                             return nullptr;
                         }
                         if(globalScope->assign(assign, ident, rhs)) {
+                            dynamicFrame = true;
                             return nullptr;
                         }
 
@@ -1182,6 +1425,13 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                         Dot::ptr dot = static_pointer_cast<Dot>(lhs);
                         Expr::ptr owner;
                         get_variable(owner, dot->owner->name);
+                        if(owner == nullptr && uniformBlocks.has(dot->owner->name)) {
+                            if(uniformBlocks.assign(dot, rhs)) {
+                                const vector<unsigned char>& contents = uniformBlocks.contents(dot->owner->name);
+                                sign(NODE_DOT, &contents[0], contents.size());
+                            }
+                            return nullptr;
+                        }
                         if(owner == nullptr || owner->type == NODE_NULL) {
                             logger->log(dot, "ERROR", "Can't assign to member of variable " + dot->owner->name);
                             return nullptr;
@@ -1189,11 +1439,23 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
 
                         if(owner->type == NODE_PROGRAM) {
                             Program::ptr program = static_pointer_cast<Program>(owner);
-                            bool reupload = false;
-                            if(current_program_name != dot->owner->name) {
+                            Decl::ptr constant = shader_constant(program, dot->name);
+                            if(constant != nullptr) {
+                                if(type_to_name(rhs->type) != constant->datatype->name) {
+                                    logger->log(dot, "ERROR", "Constant mismatch: " + constant->datatype->name + " required for " + dot->name + " of shader " + dot->owner->name);
+                                    return nullptr;
+                                }
+                                program->selection[dot->name] = rhs;
+                                // The permutation is picked again the next time a program is used
+                                stalePermutation = true;
+                                return nullptr;
+                            }
+                            program = linked(program);
+
+                            if(current_program_name != dot->owner->name || stalePermutation) {
                                 current_program_name = dot->owner->name;
-                                current_program = program;
-                                reupload = true;
+                                current_program = program != nullptr? specialize(program) : nullptr;
+                                stalePermutation = false;
                             }
 
                             if(current_program == nullptr) {
@@ -1201,165 +1463,18 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                                 return nullptr;
                             }
 
-                            if(reupload) {
-                                gl->glUseProgram(current_program->handle);
-                            }
+                            use_program(current_program->handle);
 
-                            Shader::ptr src = current_program->vertSource;
-                            string type = "";
-                            if(src->uniforms->find(dot->name) != src->uniforms->end()) {
-                                type = src->uniforms->at(dot->name);
-                            } else {
-                                src = current_program->fragSource;
-                                if(src->uniforms->find(dot->name) != src->uniforms->end()) {
-                                    type = src->uniforms->at(dot->name);
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform " + dot->name + " of shader " + current_program_name + " does not exist");
-                                    return nullptr;
-                                }
+                            string type = uniform_type(current_program, dot->name);
+                            if(type == "") {
+                                logger->log(dot, "ERROR", "Uniform " + dot->name + " of shader " + current_program_name + " does not exist");
+                                return nullptr;
                             }
 
-                            GLint loc = gl->glGetUniformLocation(current_program->handle, dot->name.c_str());
-                            if(type == "float") {
-                                if(rhs->type == NODE_FLOAT) {
-                                    Float::ptr f = static_pointer_cast<Float>(rhs);
-                                    gl->glUniform1f(loc, resolve_float(f));
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: float required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "vec2") {
-                                if(rhs->type == NODE_VECTOR2) {
-                                    Vector2::ptr vec2 = static_pointer_cast<Vector2>(eval_expr(rhs));
-                                    gl->glUniform2f(loc, resolve_vec2(vec2));
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: vec2 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else 
-                            if(type == "vec3") {
-                                if(rhs->type == NODE_VECTOR3) {
-                                    Vector3::ptr vec3 = static_pointer_cast<Vector3>(eval_expr(rhs));
-                                    gl->glUniform3f(loc, resolve_vec3(vec3));
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: vec3 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "vec4") {
-                                if(rhs->type == NODE_VECTOR4) {
-                                    Vector4::ptr vec4 = static_pointer_cast<Vector4>(eval_expr(rhs));
-                                    gl->glUniform4f(loc, resolve_vec4(vec4));
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: vec4 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "mat2") {
-                                if(rhs->type == NODE_MATRIX2) {
-                                    Matrix2::ptr mat2 = static_pointer_cast<Matrix2>(eval_expr(rhs));
-                                    float data[4];
-                                    data[0] = resolve_scalar(mat2->v0->x); data[1] = resolve_scalar(mat2->v0->y);
-                                    data[2] = resolve_scalar(mat2->v1->x); data[3] = resolve_scalar(mat2->v1->y);
-                                    gl->glUniformMatrix2fv(loc, 1, false, data);
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: vec4 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "mat3") {
-                                if(rhs->type == NODE_MATRIX3) {
-                                    Matrix3::ptr mat3 = static_pointer_cast<Matrix3>(eval_expr(rhs));
-                                    float data[9];
-                                    data[0] = resolve_scalar(mat3->v0->x); data[1] = resolve_scalar(mat3->v0->y); data[2] = resolve_scalar(mat3->v0->z);
-                                    data[3] = resolve_scalar(mat3->v1->x); data[4] = resolve_scalar(mat3->v1->y); data[5] = resolve_scalar(mat3->v1->z);
-                                    data[6] = resolve_scalar(mat3->v2->x); data[7] = resolve_scalar(mat3->v2->y); data[8] = resolve_scalar(mat3->v2->z);
-                                    gl->glUniformMatrix3fv(loc, 1, false, data);
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: mat3 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "mat4") {
-                                if(rhs->type == NODE_MATRIX4) {
-                                    Matrix4::ptr mat4 = static_pointer_cast<Matrix4>(eval_expr(rhs));
-                                    float data[16];
-                                    data[0] = resolve_scalar(mat4->v0->x); data[1] = resolve_scalar(mat4->v0->y); data[2] = resolve_scalar(mat4->v0->z); data[3] = resolve_scalar(mat4->v0->w);
-                                    data[4] = resolve_scalar(mat4->v1->x); data[5] = resolve_scalar(mat4->v1->y); data[6] = resolve_scalar(mat4->v1->z); data[7] = resolve_scalar(mat4->v1->w);
-                                    data[8] = resolve_scalar(mat4->v2->x); data[9] = resolve_scalar(mat4->v2->y); data[10] = resolve_scalar(mat4->v2->z); data[11] = resolve_scalar(mat4->v2->w);
-                                    data[12] = resolve_scalar(mat4->v3->x); data[13] = resolve_scalar(mat4->v3->y); data[14] = resolve_scalar(mat4->v3->z); data[15] = resolve_scalar(mat4->v3->w);
-                                    gl->glUniformMatrix4fv(loc, 1, false, data);
-                                } else {
-                                    logger->log(dot, "ERROR", "Uniform upload mismatch: mat3 required for " + dot->name + " of shader " + current_program_name);
-                                    return nullptr;
-                                }
-                            } else
-                            if(type == "texture2D") {
-                                switch(rhs->type) {
-                                    case NODE_TEXTURE:
-                                        {
-                                            Shader::ptr frag = current_program->fragSource;
-                                            auto texSlots = frag->textureSlots;
-                                            auto it = find(texSlots->begin(), texSlots->end(), dot->name);
-                                            activeTextureSlot = it - texSlots->begin();
-
-                                            Texture::ptr tex = static_pointer_cast<Texture>(rhs);
-                                            gl->glActiveTexture(GL_TEXTURE0 + activeTextureSlot);
-                                            if(tex->handle == 0) {
-                                                gl->glGenTextures(1, &(tex->handle));
-                                                gl->glBindTexture(GL_TEXTURE_2D, tex->handle);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                                                gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex->width, tex->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex->image);
-                                            } else {
-                                                gl->glBindTexture(GL_TEXTURE_2D, tex->handle);
-                                            }
-                                            gl->glUniform1i(loc, activeTextureSlot);
-
-                                            break;
-                                        }
-                                    case NODE_STRING:
-                                        {
-                                            string filename = static_pointer_cast<String>(rhs)->value;
-                                            if(filename == "") {
-                                                gl->glBindTexture(GL_TEXTURE_2D, 0);
-                                                gl->glActiveTexture(0);
-                                            } else {
-                                                int width, height, n;
-                                                string realfilename = "";
-                                                if(file_exists(workingDir + "/" + filename)) {
-                                                    realfilename = workingDir + "/" + filename; 
-                                                } else {
-                                                    realfilename = filename;
-                                                }
-                                                unsigned char* data = stbi_load(realfilename.c_str(), &width, &height, &n, 4);
-                                                GLuint handle = 0;
-                                                glGenTextures(1, &handle);
-                                                glBindTexture(GL_TEXTURE_2D, handle);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                                                gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-                                                glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data);
-                                                if(handle == 0) {
-                                                    string message = "Cannot load " + filename + ": ";
-                                                    message += stbi_failure_reason();
-                                                    logger->log(rhs, "ERROR", message);
-                                                    break;
-                                                }
-                                                gl->glBindTexture(GL_TEXTURE_2D, handle);
-                                                gl->glActiveTexture(GL_TEXTURE0);
-                                            }
-                                            break;
-                                        }
-                                        break;
-                                    default:
-                                        break;
-                                }
+                            if(upload_uniform(dot, type, rhs)) {
+                                program->uniformValues[dot->name] = make_pair(dot, rhs);
                             }
+                            return nullptr;
                         } else
                         if(owner->type == NODE_TEXTURE) {
                             Texture::ptr texture = static_pointer_cast<Texture>(owner);
@@ -1367,6 +1482,36 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                                 logger->log(dot->owner, "ERROR", "Field \"" + dot->name + "\" of texture is read-only");
                                 return nullptr;
                             }
+                            // Sampling settings aren't part of the frame's signature
+                            dynamicFrame = true;
+                            // Sampling settings take effect the next time the texture is bound
+                            if(dot->name == "mipmaps") {
+                                if(rhs->type != NODE_BOOL) {
+                                    logger->log(dot, "ERROR", "Field \"mipmaps\" of texture must be a bool");
+                                    return nullptr;
+                                }
+                                texture->mipmaps = static_pointer_cast<Bool>(rhs)->value;
+                                return nullptr;
+                            }
+                            if(dot->name == "filter" || dot->name == "wrap") {
+                                string value = rhs->type == NODE_STRING? static_pointer_cast<String>(rhs)->value : "";
+                                bool valid = dot->name == "filter"? (value == "nearest" || value == "linear") : (value == "repeat" || value == "clamp" || value == "mirror");
+                                if(!valid) {
+                                    string options = dot->name == "filter"? "\"nearest\" or \"linear\"" : "\"repeat\", \"clamp\" or \"mirror\"";
+                                    logger->log(dot, "ERROR", "Field \"" + dot->name + "\" of texture must be " + options);
+                                    return nullptr;
+                                }
+                                if(dot->name == "filter") {
+                                    texture->filter = value;
+                                } else {
+                                    texture->wrap = value;
+                                }
+                                return nullptr;
+                            }
+                        } else
+                        if(owner->type == NODE_PINGPONG) {
+                            logger->log(dot->owner, "ERROR", "Field \"" + dot->name + "\" of pingpong is read-only");
+                            return nullptr;
                         }
                     } else if (lhs->type == NODE_INDEX) {
                         Index::ptr in = static_pointer_cast<Index>(lhs);
@@ -1376,6 +1521,9 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                             logger->log(in, "ERROR", "Invalid index expression");
                             return nullptr;
                         }
+                        // The list, vector or matrix is changed in place, and may be held by a global
+                        // as well as whatever named it here
+                        dynamicFrame = true;
 
                         if(source->type == NODE_LIST && index->type == NODE_INT) {
                             List::ptr list = static_pointer_cast<List>(source);
@@ -1473,8 +1621,8 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                 Buffer::ptr buf = make_shared<Buffer>();
                 buf->layout = new Layout();
 
-                gl->glGenBuffers(1, &(buf->handle));
-                gl->glGenBuffers(1, &(buf->indexHandle));
+                buf->handle = registry.create(OBJECT_BUFFER);
+                own(buf, OBJECT_BUFFER, buf->handle);
 
                 scope->declare(alloc, alloc->ident, "buffer", buf);
 
@@ -1502,6 +1650,7 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                             buffer->indices.push_back(resolve_int(e));
                         }
                     }
+                    buffer->revision++;
                     return nullptr;
                 }
 
@@ -1605,6 +1754,7 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                 }
 
                 buffer->sizes[upload->attrib->name] = target->size() / buffer->layout->attributes[upload->attrib->name];
+                buffer->revision++;
 
                 return nullptr;
             }
@@ -1627,6 +1777,8 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
 
                 if(op == OP_PLUS && lhs->type == NODE_LIST) {
                     List::ptr list = static_pointer_cast<List>(lhs);
+                    // Appended to in place, like an index assign
+                    dynamicFrame = true;
 
                     if(rhs->type != NODE_UPLOADLIST) {
                        list->list.push_back(rhs);
@@ -1660,20 +1812,28 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
             }
         case NODE_DRAW:
             {
+                TRACE_SCOPE("gl", "draw");
                 Draw::ptr draw = static_pointer_cast<Draw>(stmt);
 
-                if(draw->program != nullptr) {
-                    if(current_program_name != draw->program->name) {
-                        current_program_name = draw->program->name;
-                        current_program = static_pointer_cast<Program>(globalScope->get(current_program_name));
+                string programName = draw->program != nullptr? draw->program->name : current_program_name;
+                if(current_program_name != programName || stalePermutation) {
+                    current_program_name = programName;
+                    Expr::ptr program = globalScope->get(current_program_name);
+                    current_program = nullptr;
+                    if(program != nullptr && program->type == NODE_PROGRAM) {
+                        current_program = linked(static_pointer_cast<Program>(program));
+                        if(current_program != nullptr) {
+                            current_program = specialize(current_program);
+                        }
                     }
+                    stalePermutation = false;
                 }
 
                 if(current_program == nullptr) {
                     logger->log(draw, "ERROR", "Cannot bind program with name " + current_program_name);
                     return nullptr;
                 } else {
-                    gl->glUseProgram(current_program->handle);
+                    use_program(current_program->handle);
                 }
 
                 Expr::ptr expr = nullptr;
@@ -1683,34 +1843,57 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                     return nullptr;
                 }
 
-                Texture::ptr target = static_pointer_cast<Texture>(eval_expr(draw->target));
-                if(target != nullptr) {
-                    if(target->framebuffer == 0) {
-                        gl->glGenFramebuffers(1, &(target->framebuffer));
-                        gl->glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
-
-                        if(target->handle == 0) {
-                            //TODO: Handle resizing of screen
-                            target->width = width;
-                            target->height = width; 
+                vector<Texture::ptr> targets;
+                // Swapped once the draw is done
+                vector<PingPong::ptr> pingpongs;
+                for(auto it = draw->targets.begin(); it != draw->targets.end(); ++it) {
+                    Expr::ptr value = eval_expr(*it);
+                    if(value != nullptr && value->type == NODE_PINGPONG) {
+                        PingPong::ptr pingpong = static_pointer_cast<PingPong>(value);
+                        pingpongs.push_back(pingpong);
+                        value = pingpong->write();
+                    }
+                    if(value == nullptr || value->type != NODE_TEXTURE) {
+                        logger->log(draw, "ERROR", "Can't draw into non-texture object " + (*it)->name);
+                        return nullptr;
+                    }
+                    if(find(targets.begin(), targets.end(), value) != targets.end()) {
+                        logger->log(draw, "ERROR", "Texture " + (*it)->name + " is drawn into twice");
+                        return nullptr;
+                    }
+                    targets.push_back(static_pointer_cast<Texture>(value));
+                }
+                if(targets.size() > 1 && current_program->fragSource->outputs->list.size() < targets.size()) {
+                    logger->log(draw, "ERROR", "Fragment shader of " + current_program_name + " has fewer outputs than the " + to_string(targets.size()) + " textures drawn into");
+                    return nullptr;
+                }
 
-                            gl->glGenTextures(1, &(target->handle));
-                            gl->glBindTexture(GL_TEXTURE_2D, target->handle);
-                            gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, target->width, target->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
-                            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-                            gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-                            gl->glBindTexture(GL_TEXTURE_2D, 0);
-                        }
-                        gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->handle, 0);
-                    } else {
-                        gl->glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+                for(auto it = targets.begin(); it != targets.end(); ++it) {
+                    prepare_target(*it);
+                }
+                if(targets.size() == 1) {
+                    gl->glBindFramebuffer(GL_FRAMEBUFFER, targets[0]->framebuffer);
+                } else
+                if(targets.size() > 1) {
+                    vector<RenderTargetPool::Target> attachments;
+                    for(auto it = targets.begin(); it != targets.end(); ++it) {
+                        attachments.push_back((*it)->target);
+                    }
+                    if(!renderTargets.combine(attachments)) {
+                        logger->log(draw, "ERROR", "Can't draw into " + to_string(targets.size()) + " textures at once on this GPU");
+                        return nullptr;
                     }
                 } else {
-                    gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                    gl->glBindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
                 }
+                Texture::ptr target = targets.empty()? nullptr : targets[0];
+                assign_samplers(current_program);
+                bind_textures(current_program);
 
                 Buffer::ptr buffer = static_pointer_cast<Buffer>(expr);
                 if(buffer != nullptr) {
+                    counters.uniforms += uniformBlocks.flush(&counters.bytesUploaded);
+
                     Layout* layout = buffer->layout;
                     vector<float> final_vector;
 
@@ -1730,7 +1913,11 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                         }
                     }
 
-                    gl->glBufferData(GL_ARRAY_BUFFER, final_vector.size() * sizeof(float), &final_vector[0], GL_STATIC_DRAW);
+                    {
+                        TRACE_SCOPE("gl", "upload");
+                        gl->glBufferData(GL_ARRAY_BUFFER, final_vector.size() * sizeof(float), &final_vector[0], GL_STATIC_DRAW);
+                    }
+                    counters.bytesUploaded += final_vector.size() * sizeof(float);
 
                     int total_size = 0;
                     for(auto it = layout->attributes.begin(); it != layout->attributes.end(); ++it) {
@@ -1749,16 +1936,36 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                     }
 
                     if(buffer->indices.size() > 0) {
+                        if(buffer->indexHandle == 0) {
+                            buffer->indexHandle = registry.create(OBJECT_BUFFER);
+                            own(buffer, OBJECT_BUFFER, buffer->indexHandle);
+                        }
                         gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, buffer->indexHandle);
-                        gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer->indices.size() * sizeof(unsigned int), &(buffer->indices)[0], GL_STATIC_DRAW);
+                        {
+                            TRACE_SCOPE("gl", "upload");
+                            gl->glBufferData(GL_ELEMENT_ARRAY_BUFFER, buffer->indices.size() * sizeof(unsigned int), &(buffer->indices)[0], GL_STATIC_DRAW);
+                        }
+                        counters.bytesUploaded += buffer->indices.size() * sizeof(unsigned int);
                         gl->glDrawElements(GL_TRIANGLES, buffer->indices.size(), GL_UNSIGNED_INT, 0);
                         gl->glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
                     } else {
                         gl->glDrawArrays(GL_TRIANGLES, 0, final_vector.size() / total_size);
                     }
+                    counters.draws++;
 
-                    if(draw->target != nullptr) {
-                        gl->glBindFramebuffer(GL_FRAMEBUFFER, 0);
+                    if(target != nullptr) {
+                        gl->glBindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
+                    }
+
+                    for(auto it = pingpongs.begin(); it != pingpongs.end(); ++it) {
+                        (*it)->swap();
+                        dynamicFrame = true;
+                    }
+
+                    GLuint state[4] = { current_program->handle, buffer->handle, buffer->revision, target != nullptr? target->handle : 0 };
+                    sign(NODE_DRAW, state, sizeof(state));
+                    for(unsigned int i = 1; i < targets.size(); i++) {
+                        sign(NODE_TEXTURE, &(targets[i]->handle), sizeof(GLuint));
                     }
 
                 } else {
@@ -1774,12 +1981,50 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                     Expr::ptr color = eval_expr(clear->color);
                     if(color != nullptr && color->type == NODE_VECTOR3) {
                         Vector3::ptr v = static_pointer_cast<Vector3>(color);
-                        gl->glClearColor(resolve_scalar(v->x), resolve_scalar(v->y), resolve_scalar(v->z), 1.0f);
+                        float rgb[3] = { resolve_scalar(v->x), resolve_scalar(v->y), resolve_scalar(v->z) };
+                        gl->glClearColor(rgb[0], rgb[1], rgb[2], 1.0f);
+                        sign(NODE_CLEAR, rgb, sizeof(rgb));
                     } else {
                         logger->log(clear, "ERROR", "Invalid clear color");
                     }
                 }
                 gl->glClear(GL_COLOR_BUFFER_BIT);
+                sign(NODE_CLEAR, nullptr, 0);
+                return nullptr;
+            }
+        case NODE_CAPTURE:
+            {
+                Capture::ptr capture = static_pointer_cast<Capture>(stmt);
+                dynamicFrame = true;
+                Expr::ptr path = eval_expr(capture->path);
+                if(path == nullptr || path->type != NODE_STRING) {
+                    logger->log(capture, "ERROR", "Capture needs a file name");
+                    return nullptr;
+                }
+                string pattern = static_pointer_cast<String>(path)->value;
+                if(pattern != "" && pattern[0] != '/') {
+                    pattern = workingDir + "/" + pattern;
+                }
+
+                if(capture->source == nullptr) {
+                    capture_screen(pattern);
+                    return nullptr;
+                }
+                Expr::ptr source = eval_expr(capture->source);
+                if(source != nullptr && source->type == NODE_PINGPONG) {
+                    source = static_pointer_cast<PingPong>(source)->read();
+                }
+                if(source == nullptr || source->type != NODE_TEXTURE) {
+                    logger->log(capture, "ERROR", "Can only capture the screen or a texture");
+                    return nullptr;
+                }
+                Texture::ptr tex = static_pointer_cast<Texture>(source);
+                if(tex->target == nullptr || tex->target->framebuffer == 0) {
+                    logger->log(capture, "ERROR", "Only textures that were drawn into can be captured");
+                    return nullptr;
+                }
+                frameCapture.capture(tex->target->framebuffer, tex->width, tex->height, pattern);
+                gl->glBindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
                 return nullptr;
             }
         case NODE_VIEWPORT:
@@ -1800,6 +2045,7 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                         }
 
                         gl->glViewport(bounds_int[0], bounds_int[1], bounds_int[2], bounds_int[3]);
+                        sign(NODE_VIEWPORT, bounds_int, sizeof(bounds_int));
                     } else {
                         logger->log(viewport, "ERROR", "Viewport bounds needs to be of type vec4");
                     }
@@ -1948,6 +2194,7 @@ Expr::ptr Wyatt::Interpreter::eval_stmt(Stmt::ptr stmt) {
                         {
                             vector<float> attrib_data = buffer->data[dot->name];
                             List::ptr list = make_shared<List>(nullptr);
+                            list->literal = false;
                             int size = buffer->layout->attributes[dot->name];
                             for (unsigned int i = 0; i < attrib_data.size(); i += size)
                             {
@@ -2029,7 +2276,12 @@ Expr::ptr Wyatt::Interpreter::execute_stmts(Stmts::ptr stmts) {
             break;
         }
 
+        bool profiled = profiler.enabled && profiler.enter_line(stmt->first_line);
         Expr::ptr expr = eval_stmt(stmt);
+        if(profiled) {
+            profiler.exit_line();
+        }
+
         if(expr != nullptr) {
             returnValue = expr;
             break;
@@ -2043,66 +2295,866 @@ Expr::ptr Wyatt::Interpreter::execute_stmts(Stmts::ptr stmts) {
     }
 }
 
-void Wyatt::Interpreter::compile_shader(GLuint* handle, Shader::ptr shader) {
-    transpiler->layouts = &layouts;
-    string code = transpiler->transpile(shader);
+void Wyatt::Interpreter::compile_shader(GLuint* handle, Shader::ptr shader, const string& code) {
+    TRACE_SCOPE("compile", shader->name);
     cout << code << endl;
     const char* src = code.c_str();
     gl->glShaderSource(*handle, 1, &src, nullptr);
     gl->glCompileShader(*handle);
+}
 
+void Wyatt::Interpreter::check_shader(GLuint handle, Shader::ptr shader) {
     GLint success;
     char log[256];
 
-    gl->glGetShaderInfoLog(*handle, 256, 0, log);
-    gl->glGetShaderiv(*handle, GL_COMPILE_STATUS, &success);
+    gl->glGetShaderInfoLog(handle, 256, 0, log);
+    gl->glGetShaderiv(handle, GL_COMPILE_STATUS, &success);
     if(success != GL_TRUE) {
         cout << shader->name << " shader error\n" << success << " " << log << endl;
     }
 }
 
 void Wyatt::Interpreter::compile_program() {
+    TRACE_SCOPE("compile", "compile_program");
+    vector<string> names;
     for(auto it = shaders.begin(); it != shaders.end(); ++it) {
+        names.push_back(it->first);
+    }
+    defer_programs(names);
+    release_programs();
+}
+
+// Lets the driver compile and link on its own threads, so that issuing every program before
+// asking about any of them only waits for the slowest one
+static void enable_parallel_compile() {
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context == nullptr) {
+        return;
+    }
+
+    typedef void (QOPENGLF_APIENTRYP MaxShaderCompilerThreads)(GLuint);
+    MaxShaderCompilerThreads maxShaderCompilerThreads = nullptr;
+    if(context->hasExtension("GL_KHR_parallel_shader_compile")) {
+        maxShaderCompilerThreads = (MaxShaderCompilerThreads) context->getProcAddress("glMaxShaderCompilerThreadsKHR");
+    } else if(context->hasExtension("GL_ARB_parallel_shader_compile")) {
+        maxShaderCompilerThreads = (MaxShaderCompilerThreads) context->getProcAddress("glMaxShaderCompilerThreadsARB");
+    }
+    if(maxShaderCompilerThreads != nullptr) {
+        // Let the implementation pick how many
+        maxShaderCompilerThreads(0xFFFFFFFF);
+    }
+}
+
+// Builds the programs for the named shader pairs in three passes: every shader is transpiled on
+// the thread pool, then every compile and link is issued, and only then is any status queried
+void Wyatt::Interpreter::link_programs(const vector<string>& names) {
+    #ifndef NO_GL
+    enable_parallel_compile();
+    #endif
+    uniformBlocks.update(layouts);
+
+    struct Pending {
+        string name;
+        shared_ptr<ShaderPair> pair;
+        future<std::pair<string, string>> code;
+        unsigned long long hash;
+        Program::ptr program;
+        bool compiled;
+    };
+    vector<Pending> pending;
+
+    for(auto it = names.begin(); it != names.end(); ++it) {
+        shared_ptr<ShaderPair> pair = shaders[*it];
+        programHashes.erase(*it);
+        auto first = permutations.lower_bound(make_pair(*it, 0ULL));
+        auto last = permutations.upper_bound(make_pair(*it, ~0ULL));
+        permutations.erase(first, last);
+        if(pair->vertex == nullptr) {
+            logger->log("ERROR: Missing vertex shader source for program " + *it);
+            continue;
+        }
+
+        if(pair->fragment == nullptr) {
+            logger->log("ERROR: Missing fragment shader source for program " + *it);
+            continue;
+        }
+
+        Pending p;
+        p.name = *it;
+        p.pair = pair;
+        p.code = ThreadPool::shared().submit([this, pair]() { return transpile(pair); });
+        pending.push_back(move(p));
+    }
+
+    for(auto it = pending.begin(); it != pending.end(); ++it) {
+        std::pair<string, string> code = it->code.get();
+        string vertCode = code.first;
+        string fragCode = code.second;
+        it->hash = hash_bytes(vertCode.data(), vertCode.size());
+        it->hash = hash_bytes(fragCode.data(), fragCode.size(), it->hash);
+        programHashes[it->name] = it->hash;
+
+        // Pairs that transpile to the same GLSL share a program; only the first builds it
+        for(auto previous = pending.begin(); previous != it; ++previous) {
+            if(previous->hash == it->hash) {
+                it->program = previous->program;
+                it->compiled = false;
+            }
+        }
+        if(it->program == nullptr) {
+            it->program = build_program(it->hash, it->pair, vertCode, fragCode, it->compiled);
+        }
+    }
+
+    for(auto it = pending.begin(); it != pending.end(); ++it) {
+        Program::ptr linkedProgram = it->program;
+        if(it->compiled) {
+            check_program(linkedProgram, it->pair, it->hash);
+        }
+
+        // Block bindings aren't part of the GLSL, and a program restored from a binary forgets them
+        if(linkedProgram->handle != 0) {
+            uniformBlocks.bind(linkedProgram->handle);
+        }
+
+        // Same GLSL, but uniform lookups and error messages should see the latest parse
+        linkedProgram->vertSource = it->pair->vertex;
+        linkedProgram->fragSource = it->pair->fragment;
+
+        // Only the GL program is shared with pairs of the same GLSL; the constants, uniforms and
+        // textures the script gives this pair are kept apart from theirs
+        Program::ptr program = make_shared<Program>();
+        program->handle = linkedProgram->handle;
+        program->vertSource = it->pair->vertex;
+        program->fragSource = it->pair->fragment;
+        declare_program(it->name, program);
+    }
+}
+
+// Declares a placeholder for each of the named pairs instead of building it; it's linked by
+// linked() the first time the script uses it, or by prewarm()
+void Wyatt::Interpreter::defer_programs(const vector<string>& names) {
+    // The blocks don't wait for a program to be linked; init() may well fill them in first
+    uniformBlocks.update(layouts);
+    for(auto it = names.begin(); it != names.end(); ++it) {
+        shared_ptr<ShaderPair> pair = shaders[*it];
+        programHashes.erase(*it);
+        auto first = permutations.lower_bound(make_pair(*it, 0ULL));
+        auto last = permutations.upper_bound(make_pair(*it, ~0ULL));
+        permutations.erase(first, last);
+        if(pair->vertex == nullptr) {
+            logger->log("ERROR: Missing vertex shader source for program " + *it);
+            continue;
+        }
+
+        if(pair->fragment == nullptr) {
+            logger->log("ERROR: Missing fragment shader source for program " + *it);
+            continue;
+        }
+
         Program::ptr program = make_shared<Program>();
-        program->handle = gl->glCreateProgram();
-        program->vert = gl->glCreateShader(GL_VERTEX_SHADER);
-        program->frag = gl->glCreateShader(GL_FRAGMENT_SHADER);
+        program->deferred = true;
+        program->vertSource = pair->vertex;
+        program->fragSource = pair->fragment;
+        declare_program(*it, program);
+    }
+}
+
+Program::ptr Wyatt::Interpreter::linked(Program::ptr program) {
+    // A program with constants picked is only ever drawn as one of its permutations
+    if(program == nullptr || !program->selection.empty()) {
+        return program;
+    }
+    if(!program->deferred) {
+        return program->handle != 0? program : nullptr;
+    }
+
+    string name = program->vertSource->name;
+    TRACE_SCOPE("compile", "link " + name);
+    link_programs(vector<string>(1, name));
+    Expr::ptr result = globalScope->get(name);
+    if(result != nullptr && result->type == NODE_PROGRAM && result != program) {
+        Program::ptr linkedProgram = static_pointer_cast<Program>(result);
+        return linkedProgram->handle != 0? linkedProgram : nullptr;
+    }
+
+    // The errors are already logged; don't compile it again every frame
+    program->deferred = false;
+    return nullptr;
+}
+
+void Wyatt::Interpreter::declare_program(const string& name, Program::ptr program) {
+    // After a hot reload or once a placeholder is linked, the script's constants and uniforms
+    // still apply; they're set again when the program is next used
+    Expr::ptr previous = globalScope->get(name);
+    if(previous != nullptr && previous != program && previous->type == NODE_PROGRAM) {
+        Program::ptr old = static_pointer_cast<Program>(previous);
+        program->selection = old->selection;
+        program->uniformValues = old->uniformValues;
+    }
+    program->active = nullptr;
+
+    globalScope->declare(nullptr, make_shared<Ident>(name), "program", program);
+}
+
+// The program for a pair's transpiled GLSL: a cached one, one restored from disk, or a new one
+// whose compile and link have been issued but not checked yet, in which case compiled is set.
+// A new program is only cached by check_program(), once it's known to have linked
+Program::ptr Wyatt::Interpreter::build_program(unsigned long long hash, shared_ptr<ShaderPair> pair, const string& vertCode, const string& fragCode, bool& compiled) {
+    compiled = false;
+    Program::ptr program = programCache.find(hash);
+    if(program != nullptr) {
+        return program;
+    }
+
+    program = make_shared<Program>();
+    program->handle = diskCache.load_program(hash);
+    registry.adopt(OBJECT_PROGRAM, program->handle);
+    if(program->handle == 0) {
+        program->handle = registry.create(OBJECT_PROGRAM);
+        program->vert = registry.create_shader(GL_VERTEX_SHADER);
+        program->frag = registry.create_shader(GL_FRAGMENT_SHADER);
 
         gl->glAttachShader(program->handle, program->vert);
         gl->glAttachShader(program->handle, program->frag);
 
-        program->vertSource = it->second->vertex;
-        program->fragSource = it->second->fragment;
+        compile_shader(&(program->vert), pair->vertex, vertCode);
+        compile_shader(&(program->frag), pair->fragment, fragCode);
 
-        if(program->vertSource == nullptr) {
-            logger->log("ERROR: Missing vertex shader source for program " + it->first);
-            continue;
+        diskCache.prepare_program(program->handle);
+        gl->glLinkProgram(program->handle);
+        compiled = true;
+        return program;
+    }
+    programCache.insert(hash, program);
+    return program;
+}
+
+void Wyatt::Interpreter::check_program(Program::ptr program, shared_ptr<ShaderPair> pair, unsigned long long hash) {
+    check_shader(program->vert, pair->vertex);
+    check_shader(program->frag, pair->fragment);
+
+    GLint success;
+    char log[256];
+    gl->glGetProgramiv(program->handle, GL_LINK_STATUS, &success);
+    gl->glGetProgramInfoLog(program->handle, 256, 0, log);
+    if(success != GL_TRUE) {
+        logger->log("ERROR: Can't compile program-- see error log below for details");
+        logger->log(string(log));
+        // Nothing draws with it, and the same GLSL is compiled again (and its errors shown again)
+        // on the next reload rather than handed back from the cache
+        registry.release(OBJECT_SHADER, program->vert);
+        registry.release(OBJECT_SHADER, program->frag);
+        registry.release(OBJECT_PROGRAM, program->handle);
+        program->vert = program->frag = program->handle = 0;
+        failedPrograms.insert(hash);
+    } else {
+        diskCache.store_program(hash, program->handle);
+        programCache.insert(hash, program);
+    }
+}
+
+// The permutation of program for the constants the script picked, made current. Permutations are
+// only built the first time they're used, and switching to one sets the uniforms the script gave
+// the program again, since each permutation is a GL program of its own
+Program::ptr Wyatt::Interpreter::specialize(Program::ptr program) {
+    Program::ptr variant = program;
+    if(!program->selection.empty()) {
+        variant = permutation(program);
+        if(variant == nullptr) {
+            return nullptr;
         }
+    }
+
+    // Another pair with the same GLSL may have set the GL program's uniforms since
+    if(variant != program->active || uniformOwners[variant->handle].lock() != program) {
+        program->active = variant;
+        uniformOwners[variant->handle] = program;
+        use_program(variant->handle);
+        Program::ptr previous = current_program;
+        current_program = variant;
+        for(auto it = program->uniformValues.begin(); it != program->uniformValues.end(); ++it) {
+            string type = uniform_type(variant, it->first);
+            if(type != "") {
+                upload_uniform(it->second.first, type, it->second.second);
+            }
+        }
+        current_program = previous;
+    }
+    return variant;
+}
 
-        if(program->fragSource == nullptr) {
-            logger->log("ERROR: Missing fragment shader source for program " + it->first);
+Program::ptr Wyatt::Interpreter::permutation(Program::ptr program) {
+    string name = program->vertSource->name;
+    unsigned long long key = HASH_SEED;
+    for(auto it = program->selection.begin(); it != program->selection.end(); ++it) {
+        Expr::ptr value = it->second;
+        string text = it->first + "=" + (value->type == NODE_FLOAT? float_literal(resolve_float(value)) : print_expr(value)) + ";";
+        key = hash_bytes(text.data(), text.size(), key);
+    }
+
+    Program::ptr linkedProgram = nullptr;
+    auto found = permutations.find(make_pair(name, key));
+    if(found != permutations.end()) {
+        // Its errors were shown when it was built
+        if(failedPrograms.count(found->second) != 0) {
+            return nullptr;
+        }
+        linkedProgram = programCache.find(found->second);
+    }
+    if(linkedProgram == nullptr) {
+        linkedProgram = build_permutation(program, name, key);
+        if(linkedProgram == nullptr) {
+            return nullptr;
+        }
+    }
+
+    // Like the pairs themselves, permutations with the same GLSL only share the GL program
+    Program::ptr& variant = program->variants[key];
+    if(variant == nullptr || variant->handle != linkedProgram->handle) {
+        variant = make_shared<Program>();
+        variant->handle = linkedProgram->handle;
+        variant->vertSource = linkedProgram->vertSource;
+        variant->fragSource = linkedProgram->fragSource;
+    }
+    return variant;
+}
+
+// Builds (or restores) the GL program of the permutation of program picked by key, or returns
+// nullptr if it fails to link
+Program::ptr Wyatt::Interpreter::build_permutation(Program::ptr program, const string& name, unsigned long long key) {
+    auto source = shaders.find(name);
+    if(source == shaders.end() || !source->second->vertex || !source->second->fragment) {
+        return nullptr;
+    }
+    TRACE_SCOPE("compile", "specialize " + name);
+
+    shared_ptr<ShaderPair> pair = make_shared<ShaderPair>();
+    pair->name = name;
+    pair->vertex = specialize_shader(source->second->vertex, program->selection, key);
+    pair->fragment = specialize_shader(source->second->fragment, program->selection, key);
+
+    std::pair<string, string> code = transpile(pair);
+    unsigned long long hash = hash_bytes(code.first.data(), code.first.size());
+    hash = hash_bytes(code.second.data(), code.second.size(), hash);
+
+    bool compiled;
+    Program::ptr linkedProgram = build_program(hash, pair, code.first, code.second, compiled);
+    if(compiled) {
+        check_program(linkedProgram, pair, hash);
+    }
+    permutations[make_pair(name, key)] = hash;
+    if(linkedProgram->handle == 0) {
+        return nullptr;
+    }
+    uniformBlocks.bind(linkedProgram->handle);
+    linkedProgram->vertSource = pair->vertex;
+    linkedProgram->fragSource = pair->fragment;
+    return linkedProgram;
+}
+
+// A copy of shader with the picked values in place of its constants' defaults. key tells the
+// permutation apart on disk
+Shader::ptr Wyatt::Interpreter::specialize_shader(Shader::ptr shader, const map<string, Expr::ptr>& selection, unsigned long long key) {
+    Shader::ptr result = make_shared<Shader>(*shader);
+    result->constants = make_shared<map<string, Decl::ptr>>(*shader->constants);
+    for(auto it = result->constants->begin(); it != result->constants->end(); ++it) {
+        auto picked = selection.find(it->first);
+        if(picked != selection.end()) {
+            Decl::ptr decl = make_shared<Decl>(*it->second);
+            decl->value = picked->second;
+            it->second = decl;
+        }
+    }
+    if(shader->digest != 0) {
+        result->digest = hash_bytes(&key, sizeof(key), shader->digest);
+    }
+    return result;
+}
+
+// Compile-time constant of either of program's shaders, or nullptr
+Decl::ptr Wyatt::Interpreter::shader_constant(Program::ptr program, const string& name) {
+    Shader::ptr sources[] = { program->vertSource, program->fragSource };
+    for(Shader::ptr source : sources) {
+        auto found = source->constants->find(name);
+        if(found != source->constants->end()) {
+            return found->second;
+        }
+    }
+    return nullptr;
+}
+
+string Wyatt::Interpreter::uniform_type(Program::ptr program, const string& name) {
+    Shader::ptr sources[] = { program->vertSource, program->fragSource };
+    for(Shader::ptr source : sources) {
+        auto found = source->uniforms->find(name);
+        if(found != source->uniforms->end()) {
+            return found->second;
+        }
+    }
+    return "";
+}
+
+// Sets the uniform of the current program, which must be in use; false on a type mismatch
+bool Wyatt::Interpreter::upload_uniform(Dot::ptr dot, const string& type, Expr::ptr rhs) {
+    GLint loc = gl->glGetUniformLocation(current_program->handle, dot->name.c_str());
+    if(type == "float") {
+        if(rhs->type == NODE_FLOAT) {
+            Float::ptr f = static_pointer_cast<Float>(rhs);
+            gl->glUniform1f(loc, resolve_float(f));
+            counters.uniforms++;
+            sign(NODE_FLOAT, &(f->value), sizeof(float));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: float required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "vec2") {
+        if(rhs->type == NODE_VECTOR2) {
+            Vector2::ptr vec2 = static_pointer_cast<Vector2>(eval_expr(rhs));
+            float data[2] = { resolve_vec2(vec2) };
+            gl->glUniform2fv(loc, 1, data);
+            counters.uniforms++;
+            sign(NODE_VECTOR2, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: vec2 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else 
+    if(type == "vec3") {
+        if(rhs->type == NODE_VECTOR3) {
+            Vector3::ptr vec3 = static_pointer_cast<Vector3>(eval_expr(rhs));
+            float data[3] = { resolve_vec3(vec3) };
+            gl->glUniform3fv(loc, 1, data);
+            counters.uniforms++;
+            sign(NODE_VECTOR3, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: vec3 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "vec4") {
+        if(rhs->type == NODE_VECTOR4) {
+            Vector4::ptr vec4 = static_pointer_cast<Vector4>(eval_expr(rhs));
+            float data[4] = { resolve_vec4(vec4) };
+            gl->glUniform4fv(loc, 1, data);
+            counters.uniforms++;
+            sign(NODE_VECTOR4, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: vec4 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "mat2") {
+        if(rhs->type == NODE_MATRIX2) {
+            Matrix2::ptr mat2 = static_pointer_cast<Matrix2>(eval_expr(rhs));
+            float data[4];
+            data[0] = resolve_scalar(mat2->v0->x); data[1] = resolve_scalar(mat2->v0->y);
+            data[2] = resolve_scalar(mat2->v1->x); data[3] = resolve_scalar(mat2->v1->y);
+            gl->glUniformMatrix2fv(loc, 1, false, data);
+            counters.uniforms++;
+            sign(NODE_MATRIX2, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: vec4 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "mat3") {
+        if(rhs->type == NODE_MATRIX3) {
+            Matrix3::ptr mat3 = static_pointer_cast<Matrix3>(eval_expr(rhs));
+            float data[9];
+            data[0] = resolve_scalar(mat3->v0->x); data[1] = resolve_scalar(mat3->v0->y); data[2] = resolve_scalar(mat3->v0->z);
+            data[3] = resolve_scalar(mat3->v1->x); data[4] = resolve_scalar(mat3->v1->y); data[5] = resolve_scalar(mat3->v1->z);
+            data[6] = resolve_scalar(mat3->v2->x); data[7] = resolve_scalar(mat3->v2->y); data[8] = resolve_scalar(mat3->v2->z);
+            gl->glUniformMatrix3fv(loc, 1, false, data);
+            counters.uniforms++;
+            sign(NODE_MATRIX3, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: mat3 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "mat4") {
+        if(rhs->type == NODE_MATRIX4) {
+            Matrix4::ptr mat4 = static_pointer_cast<Matrix4>(eval_expr(rhs));
+            float data[16];
+            data[0] = resolve_scalar(mat4->v0->x); data[1] = resolve_scalar(mat4->v0->y); data[2] = resolve_scalar(mat4->v0->z); data[3] = resolve_scalar(mat4->v0->w);
+            data[4] = resolve_scalar(mat4->v1->x); data[5] = resolve_scalar(mat4->v1->y); data[6] = resolve_scalar(mat4->v1->z); data[7] = resolve_scalar(mat4->v1->w);
+            data[8] = resolve_scalar(mat4->v2->x); data[9] = resolve_scalar(mat4->v2->y); data[10] = resolve_scalar(mat4->v2->z); data[11] = resolve_scalar(mat4->v2->w);
+            data[12] = resolve_scalar(mat4->v3->x); data[13] = resolve_scalar(mat4->v3->y); data[14] = resolve_scalar(mat4->v3->z); data[15] = resolve_scalar(mat4->v3->w);
+            gl->glUniformMatrix4fv(loc, 1, false, data);
+            counters.uniforms++;
+            sign(NODE_MATRIX4, data, sizeof(data));
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: mat3 required for " + dot->name + " of shader " + dot->owner->name);
+            return false;
+        }
+    } else
+    if(type == "texture2D") {
+        Shader::ptr frag = current_program->fragSource;
+        auto texSlots = frag->textureSlots;
+        int unit = find(texSlots->begin(), texSlots->end(), dot->name) - texSlots->begin();
+        switch(rhs->type) {
+            case NODE_TEXTURE:
+            case NODE_PINGPONG:
+                // Bound when something is drawn with the program; see bind_textures()
+                assign_samplers(current_program);
+                current_program->textures[unit] = rhs;
+                break;
+            case NODE_STRING:
+                {
+                    string filename = static_pointer_cast<String>(rhs)->value;
+                    if(filename == "") {
+                        current_program->textures[unit] = nullptr;
+                    } else {
+                        string realfilename = "";
+                        if(file_exists(workingDir + "/" + filename)) {
+                            realfilename = workingDir + "/" + filename; 
+                        } else {
+                            realfilename = filename;
+                        }
+                        // Uploaded (and later found in the cache) like any other texture; there is
+                        // no variable to hold it while it decodes, so this waits for it
+                        Texture::ptr tex = make_shared<Texture>();
+                        textures.load(tex, realfilename, rhs);
+                        textures.resolve(tex, true);
+                        return upload_uniform(dot, type, tex);
+                    }
+                    break;
+                }
+            default:
+                break;
+        }
+    }
+    return true;
+}
+
+// Transpiled GLSL only depends on the text of both shaders (the optimizer trims varyings across
+// the pair) and the layouts they can expand, so that's what it's looked up by on disk. Runs on the
+// thread pool, so it uses a transpiler of its own
+pair<string, string> Wyatt::Interpreter::transpile(shared_ptr<ShaderPair> shaderPair) {
+    bool cacheable = shaderPair->vertex->digest != 0 && shaderPair->fragment->digest != 0;
+    unsigned long long key = hash_bytes(&(shaderPair->vertex->digest), sizeof(shaderPair->vertex->digest));
+    key = hash_bytes(&(shaderPair->fragment->digest), sizeof(shaderPair->fragment->digest), key);
+    for(auto it = layouts.begin(); it != layouts.end(); ++it) {
+        key = hash_bytes(&(it->second->digest), sizeof(it->second->digest), key);
+    }
+    unsigned long long vertKey = hash_bytes("vertex", 6, key);
+    unsigned long long fragKey = hash_bytes("fragment", 8, key);
+
+    pair<string, string> code;
+    if(cacheable && diskCache.load_glsl(vertKey, code.first) && diskCache.load_glsl(fragKey, code.second)) {
+        return code;
+    }
+
+    TRACE_SCOPE("compile", "transpile " + shaderPair->name);
+    GLSLTranspiler transpiler(logger);
+    transpiler.layouts = &layouts;
+    shared_ptr<ShaderPair> optimized;
+    {
+        TRACE_SCOPE("compile", "optimize " + shaderPair->name);
+        GLSLOptimizer optimizer(&transpiler);
+        optimized = optimizer.optimize(shaderPair);
+    }
+
+    code.first = transpiler.transpile(optimized->vertex);
+    unsigned int errors = transpiler.errors;
+    code.second = transpiler.transpile(optimized->fragment, true);
+    errors += transpiler.errors;
+    if(cacheable && errors == 0) {
+        diskCache.store_glsl(vertKey, code.first);
+        diskCache.store_glsl(fragKey, code.second);
+    }
+    return code;
+}
+
+// Deletes the cached programs no shader refers to anymore
+void Wyatt::Interpreter::release_programs() {
+    set<unsigned long long> live;
+    for(auto it = programHashes.begin(); it != programHashes.end();) {
+        if(shaders.find(it->first) == shaders.end()) {
+            it = programHashes.erase(it);
+        } else {
+            live.insert(it->second);
+            ++it;
+        }
+    }
+    for(auto it = permutations.begin(); it != permutations.end();) {
+        if(shaders.find(it->first.first) == shaders.end()) {
+            it = permutations.erase(it);
+        } else {
+            live.insert(it->second);
+            ++it;
+        }
+    }
+
+    vector<Program::ptr> unused = programCache.sweep(live);
+    for(auto it = unused.begin(); it != unused.end(); ++it) {
+        Program::ptr program = *it;
+        if(program->handle == boundProgram) {
+            use_program(0);
+        }
+        registry.release(OBJECT_SHADER, program->vert);
+        registry.release(OBJECT_SHADER, program->frag);
+        registry.release(OBJECT_PROGRAM, program->handle);
+    }
+}
+
+// Creates tex's GL texture from its pixels, or its compressed levels, and leaves it bound to unit.
+// Images loaded from a file are handed to the TextureCache
+void Wyatt::Interpreter::upload_texture(Texture::ptr tex, int unit) {
+    TRACE_SCOPE("gl", "upload");
+    GLenum format = tex->format != 0? tex->format : GL_RGBA;
+    bool reused;
+    tex->handle = registry.create_texture(tex->width, tex->height, format, reused);
+    tex->state = make_shared<TextureState>();
+    bind_texture(unit, tex->handle);
+
+    unsigned long long bytes = 0;
+    if(tex->format != 0) {
+        // Every level of the chain the file has; none are generated for compressed images
+        for(unsigned int i = 0; i < tex->levels.size(); i++) {
+            TextureLevel level = tex->levels[i];
+            gl->glCompressedTexImage2D(GL_TEXTURE_2D, i, tex->format, level.width, level.height, 0, level.size, tex->image.get() + level.offset);
+            bytes += level.size;
+        }
+        tex->state->levels = tex->levels.size();
+        tex->state->compressed = true;
+    } else {
+        if(reused) {
+            gl->glTexSubImage2D(GL_TEXTURE_2D, 0, 0, 0, tex->width, tex->height, GL_RGBA, GL_UNSIGNED_BYTE, tex->image.get());
+        } else {
+            gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, tex->width, tex->height, 0, GL_RGBA, GL_UNSIGNED_BYTE, tex->image.get());
+        }
+        bytes = (unsigned long long) tex->width * tex->height * 4;
+    }
+    // A file's chain may stop short of 1x1, and a reused texture may have had a different one;
+    // either way GL must only sample the levels there are, or the texture is incomplete and black.
+    // Generated mipmaps go all the way down, so those get GL's default range back
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_BASE_LEVEL, 0);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAX_LEVEL, tex->state->compressed? tex->state->levels - 1 : 1000);
+    counters.bytesUploaded += bytes;
+    // Nothing reads the pixels back, so the GPU's copy is the only one kept
+    tex->image = nullptr;
+    tex->levels.clear();
+
+    if(tex->source != "") {
+        tex->cached = textureCache.insert(tex->source, tex->mtime, tex->handle, tex->width, tex->height, tex->channels, bytes, tex->state);
+        // Another texture uploaded the same file first
+        if(tex->cached->handle != tex->handle) {
+            registry.release(OBJECT_TEXTURE, tex->handle);
+            tex->handle = tex->cached->handle;
+            tex->state = tex->cached->state;
+            bind_texture(unit, tex->handle);
+        }
+        release_objects();
+    }
+}
+
+// Points each sampler of program at its unit, which is its index in the fragment shader's
+// textureSlots. Uniforms belong to the GL program, so this is done once per program linked (or
+// restored), with it in use
+void Wyatt::Interpreter::assign_samplers(Program::ptr program) {
+    if(program->samplersHandle == program->handle) {
+        return;
+    }
+    auto texSlots = program->fragSource->textureSlots;
+    for(unsigned int i = 0; i < texSlots->size(); i++) {
+        GLint loc = gl->glGetUniformLocation(program->handle, (*texSlots)[i].c_str());
+        if(loc != -1) {
+            gl->glUniform1i(loc, i);
+            counters.uniforms++;
+        }
+    }
+    program->samplersHandle = program->handle;
+}
+
+// Binds the textures assigned to program's samplers to their units, right before a draw. Units
+// already holding the right texture are left alone
+void Wyatt::Interpreter::bind_textures(Program::ptr program) {
+    for(auto it = program->textures.begin(); it != program->textures.end(); ++it) {
+        int unit = it->first;
+        Expr::ptr value = it->second;
+        // A pingpong is sampled from whichever side was drawn into last
+        if(value != nullptr && value->type == NODE_PINGPONG) {
+            value = static_pointer_cast<PingPong>(value)->read();
+        }
+        Texture::ptr tex = static_pointer_cast<Texture>(value);
+        if(tex == nullptr) {
+            bind_texture(unit, 0);
             continue;
         }
 
-        compile_shader(&(program->vert), program->vertSource);
-        compile_shader(&(program->frag), program->fragSource);
+        if(tex->loading) {
+            textures.resolve(tex, false);
+        }
+        // The pool zeroes its targets on reset
+        if(tex->target != nullptr) {
+            tex->handle = tex->target->texture;
+        }
+        if(tex->handle == 0 && tex->format != 0 && !textures.supports(tex->format)) {
+            logger->log("ERROR: This GPU can't sample the compressed format of " + tex->source);
+            tex->image = nullptr;
+            tex->format = 0;
+            tex->levels.clear();
+        }
+        if(tex->handle == 0 && tex->image == nullptr) {
+            // Still decoding, or it failed to load. Making the placeholder may bind it
+            GLuint placeholder = textures.placeholder();
+            boundTextures.erase(activeUnit);
+            bind_texture(unit, placeholder);
+
+            GLuint binding[2] = { placeholder, (GLuint) unit };
+            sign(NODE_TEXTURE, binding, sizeof(binding));
+            continue;
+        }
 
-        GLint success;
-        char log[256];
-        gl->glLinkProgram(program->handle);
-        gl->glGetProgramiv(program->handle, GL_LINK_STATUS, &success);
-        gl->glGetProgramInfoLog(program->handle, 256, 0, log);
-        if(success != GL_TRUE) {
-            logger->log("ERROR: Can't compile program-- see error log below for details");
-            logger->log(string(log));
+        if(tex->handle == 0) {
+            upload_texture(tex, unit);
+        } else {
+            bind_texture(unit, tex->handle);
         }
+        apply_sampling(tex, unit);
+
+        GLuint binding[2] = { tex->handle, (GLuint) unit };
+        sign(NODE_TEXTURE, binding, sizeof(binding));
+    }
+}
+
+void Wyatt::Interpreter::bind_texture(int unit, GLuint handle) {
+    auto bound = boundTextures.find(unit);
+    if(bound != boundTextures.end() && bound->second == handle) {
+        counters.elided++;
+        return;
+    }
+    select_unit(unit);
+    gl->glBindTexture(GL_TEXTURE_2D, handle);
+    boundTextures[unit] = handle;
+}
+
+void Wyatt::Interpreter::select_unit(int unit) {
+    if(unit != activeUnit) {
+        gl->glActiveTexture(GL_TEXTURE0 + unit);
+        activeUnit = unit;
+    }
+}
+
+// Gives tex a render target of the screen's size if it has none, or its last one is out of date
+// because the window was resized or the pool was cleared
+void Wyatt::Interpreter::prepare_target(Texture::ptr tex) {
+    RenderTargetPool::Target current = tex->target;
+    if(current == nullptr || current->framebuffer == 0 || current->width != (int) width || current->height != (int) height) {
+        tex->target = renderTargets.acquire(width, height, GL_RGBA);
+        // Setting up a new target leaves nothing bound to the active unit
+        boundTextures.erase(activeUnit);
+        tex->handle = tex->target->texture;
+        tex->framebuffer = tex->target->framebuffer;
+        tex->width = width;
+        tex->height = height;
+        tex->state = tex->target->state;
+        // Drawing replaces whatever image the texture had
+        tex->image = nullptr;
+        tex->cached = nullptr;
+    }
+    // Only level 0 is drawn to, so any mipmaps are out of date
+    tex->state->levels = 1;
+}
+
+// Sets the filters and wrap mode of tex, bound to unit, to what it asks for, generating its mipmaps
+// first if it wants them. The GL texture may be shared with other texture2Ds, so its state is
+// compared rather than tex's settings
+void Wyatt::Interpreter::apply_sampling(Texture::ptr tex, int unit) {
+    if(tex->state == nullptr) {
+        tex->state = make_shared<TextureState>();
+    }
+    TextureState& state = *(tex->state);
+    if(tex->mipmaps && state.levels == 1 && !state.compressed) {
+        select_unit(unit);
+        gl->glGenerateMipmap(GL_TEXTURE_2D);
+        state.levels = 1 + (int) log2(max(tex->width, tex->height));
+    }
+
+    bool mipmapped = state.levels > 1;
+    GLenum minFilter, magFilter;
+    if(tex->filter == "nearest") {
+        minFilter = mipmapped? GL_NEAREST_MIPMAP_NEAREST : GL_NEAREST;
+        magFilter = GL_NEAREST;
+    } else
+    if(tex->filter == "linear") {
+        minFilter = mipmapped? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+        magFilter = GL_LINEAR;
+    } else {
+        minFilter = mipmapped? GL_LINEAR_MIPMAP_LINEAR : GL_LINEAR;
+        magFilter = GL_NEAREST;
+    }
+
+    GLenum wrap = GL_REPEAT;
+    if(tex->wrap == "clamp") {
+        wrap = GL_CLAMP_TO_EDGE;
+    } else
+    if(tex->wrap == "mirror") {
+        wrap = GL_MIRRORED_REPEAT;
+    }
+
+    if(state.minFilter != minFilter || state.magFilter != magFilter) {
+        select_unit(unit);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, minFilter);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, magFilter);
+        state.minFilter = minFilter;
+        state.magFilter = magFilter;
+    }
+    if(state.wrap != wrap) {
+        select_unit(unit);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, wrap);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, wrap);
+        state.wrap = wrap;
+    }
+}
 
-        globalScope->declare(nullptr, make_shared<Ident>(program->vertSource->name), "program", program);
+void Wyatt::Interpreter::own(Expr::ptr value, GLObjectKind kind, GLuint name) {
+    OwnedObject object;
+    object.value = value;
+    object.kind = kind;
+    object.name = name;
+    ownedObjects.push_back(object);
+}
+
+// Hands back to the registry the objects of buffers the script no longer refers to (every one of
+// them with all), and whatever the TextureCache evicts
+void Wyatt::Interpreter::release_objects(bool all) {
+    vector<GLuint> evicted = textureCache.evict();
+    for(auto it = evicted.begin(); it != evicted.end(); ++it) {
+        registry.release(OBJECT_TEXTURE, *it);
+    }
+
+    for(auto it = ownedObjects.begin(); it != ownedObjects.end();) {
+        Expr::ptr value = it->value.lock();
+        if(value != nullptr && !all) {
+            ++it;
+            continue;
+        }
+        // Values kept elsewhere, e.g. uniforms to restore on a program, can outlive a reset; the
+        // names they held may be handed to something else now
+        if(value != nullptr && value->type == NODE_BUFFER) {
+            Buffer::ptr buffer = static_pointer_cast<Buffer>(value);
+            if(buffer->handle == it->name) buffer->handle = 0;
+            if(buffer->indexHandle == it->name) buffer->indexHandle = 0;
+        }
+        registry.release(it->kind, it->name);
+        it = ownedObjects.erase(it);
     }
 }
 
+string Wyatt::Interpreter::memory_report() {
+    return "Texture memory: " + to_string(TextureLoader::pixel_bytes() / 1024) + " KB CPU, " +
+        to_string((textureCache.bytes() + renderTargets.bytes()) / 1024) + " KB GPU (" +
+        to_string(textureCache.size()) + " images, " + to_string(renderTargets.size()) + " render targets)";
+}
+
 void Wyatt::Interpreter::execute_init() {
     if(!init || status) return;
+    TRACE_SCOPE("execute", "execute_init");
+    find_screen();
 
     Decl::ptr piDecl = make_shared<Decl>(make_shared<Ident>("float"), make_shared<Ident>("PI"), make_shared<Float>(3.14159f));
     piDecl->constant = true;
@@ -2116,10 +3168,18 @@ void Wyatt::Interpreter::execute_init() {
     Decl::ptr aspectDecl = make_shared<Decl>(make_shared<Ident>("float"), make_shared<Ident>("ASPECT_RATIO"), make_shared<Float>(float(width) / height));
     aspectDecl->constant = true;
 
+    Decl::ptr timeDecl = make_shared<Decl>(make_shared<Ident>("float"), make_shared<Ident>("TIME"), make_shared<Float>(elapsedTime));
+    timeDecl->constant = true;
+
+    Decl::ptr deltaDecl = make_shared<Decl>(make_shared<Ident>("float"), make_shared<Ident>("DELTA_TIME"), make_shared<Float>(deltaTime));
+    deltaDecl->constant = true;
+
     globals.insert(globals.begin(), piDecl);
     globals.insert(globals.begin(), widthDecl);
     globals.insert(globals.begin(), heightDecl);
     globals.insert(globals.begin(), aspectDecl);
+    globals.insert(globals.begin(), timeDecl);
+    globals.insert(globals.begin(), deltaDecl);
 
     for(auto it = globals.begin(); it != globals.end(); ++it) {
         Decl::ptr decl = *it;
@@ -2131,42 +3191,65 @@ void Wyatt::Interpreter::execute_init() {
 
 void Wyatt::Interpreter::execute_loop() {
     if(!loop || status) return;
-
+    TRACE_SCOPE("execute", "execute_loop");
+
+    frameSignature = HASH_SEED;
+    dynamicFrame = false;
+    counters = FrameCounters();
+    // Anything else drawing into the context between frames (e.g. the HUD) may have changed the bound program
+    // and textures
+    boundProgram = 0;
+    boundTextures.clear();
+    activeUnit = -1;
+    find_screen();
+
+    unsigned long long allocations = node_allocations;
+    auto start = chrono::steady_clock::now();
+    if(profiler.enabled) {
+        profiler.frames++;
+    }
     invoke(loop_invoke);
+    if(textures.pending() > 0) {
+        dynamicFrame = true;
+    }
+    // Buffers declared in loop() are gone by now; the registry hands their names to next frame's
+    release_objects();
+    renderTargets.collect();
+    frameCapture.end_frame();
+    counters.interpretMs = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+    counters.allocations = node_allocations - allocations;
 }
 
-void Wyatt::Interpreter::load_imports() {
-    for(unsigned int i = 0; i < imports.size(); i++) {
-        string file = imports[i];
-        load_import(file);
-    }
+void Wyatt::Interpreter::capture_screen(const string& pattern) {
+    frameCapture.capture(screenFramebuffer, width, height, pattern);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, screenFramebuffer);
 }
 
-void Wyatt::Interpreter::load_import(string file) {
-    string src = "";
-    if(file_exists(workingDir + "/" + file)) {
-        src = str_from_file(workingDir + "/" + file);
-    } else {
-        src = str_from_file(file);
-    }
-    int import_status = 0;
-    parse(src, &import_status);
-    if(import_status != 0) {
-        logger->log("Error importing " + file);
+// What's bound when the script starts running is where drawing without a target goes; a widget
+// draws into a framebuffer of its own rather than 0
+void Wyatt::Interpreter::find_screen() {
+    GLint binding = 0;
+    gl->glGetIntegerv(GL_FRAMEBUFFER_BINDING, &binding);
+    screenFramebuffer = binding;
+}
+
+void Wyatt::Interpreter::use_program(GLuint handle) {
+    if(handle == boundProgram) {
+        counters.elided++;
+        return;
     }
+    gl->glUseProgram(handle);
+    boundProgram = handle;
 }
 
-void Wyatt::Interpreter::parse(string code, int* status) {
-    logger->clear();
-    istringstream ss(code);
-    *(scanner.line) = 1;
-    *(scanner.column) = 1;
-    scanner.switch_streams(&ss, nullptr);
-    *status = parser.parse();
+void Wyatt::Interpreter::sign(NodeType type, const void* data, size_t size) {
+    frameSignature = hash_bytes(&type, sizeof(type), frameSignature);
+    frameSignature = hash_bytes(data, size, frameSignature);
 }
 
 void Wyatt::Interpreter::prepare() {
     globalScope->clear();
+    release_objects();
 
     if(status == 0) {
         CodeEditor::autocomplete_functions = functions;
@@ -2186,7 +3269,18 @@ void Wyatt::Interpreter::prepare() {
 void Wyatt::Interpreter::resize(int width, int height) {
     this->width = width;
     this->height = height;
+    renderTargets.resize(width, height);
 
     globalScope->fast_assign("WIDTH", make_shared<Int>(width));
     globalScope->fast_assign("HEIGHT", make_shared<Int>(height));
 }
+
+void Wyatt::Interpreter::set_time(float elapsedTime, float deltaTime) {
+    this->elapsedTime = elapsedTime;
+    this->deltaTime = deltaTime;
+
+    timeValue = make_shared<Float>(elapsedTime);
+    deltaValue = make_shared<Float>(deltaTime);
+    globalScope->fast_assign("TIME", timeValue);
+    globalScope->fast_assign("DELTA_TIME", deltaValue);
+}
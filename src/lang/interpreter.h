@@ -6,12 +6,14 @@
 #include <fstream>
 #include <iomanip>
 #include <map>
+#include <set>
 #include <stack>
 #include <vector>
 #include <string>
 #include <ctime>
 #include <regex>
 #include <memory>
+#include <chrono>
 
 #include "dummyglfunctions.h"
 #include <QOpenGLFunctions>
@@ -22,13 +24,26 @@
 #include <QMatrix3x3>
 #include <QMatrix4x4>
 
-#include "scanner.h"
 #include "parser.hpp"
 #include "logwindow.h"
 #include "helper.h"
 #include "glsltranspiler.h"
+#include "glsloptimizer.h"
 #include "scope.h"
 #include "scopelist.h"
+#include "script.h"
+#include "stats.h"
+#include "profiler.h"
+#include "programcache.h"
+#include "diskcache.h"
+#include "glregistry.h"
+#include "uniformblocks.h"
+#include "texturecache.h"
+#include "textureloader.h"
+#include "rendertargetpool.h"
+#include "framecapture.h"
+#include "threadpool.h"
+#include "trace.h"
 #include "codeeditor.h"
 
 // #define NO_GL
@@ -131,28 +146,54 @@ class Interpreter {
         string workingDir = "";
 
         unsigned int width, height;
-
-        void parse(string, int*);
+        // Seconds since the program was (re)loaded, and since the previous frame
+        float elapsedTime = 0, deltaTime = 0;
+
+        // Hash of every GL command issued by the last execute_loop()
+        unsigned long long frameSignature = HASH_SEED;
+        // Set when the last execute_loop() read TIME or DELTA_TIME, changed a global, changed a
+        // list, vector, matrix or texture in place, swapped a pingpong, captured or left images
+        // loading; running it again may then draw something else even with the same signature
+        bool dynamicFrame = true;
+        // What the last execute_loop() cost; see stats.h
+        FrameCounters counters;
+        Profiler profiler;
+        // Survives reset(), so reloading only compiles shaders whose GLSL changed
+        ProgramCache programCache;
+        // Survives reset() too, so re-running a script doesn't decode or upload its images again
+        TextureCache textureCache;
+        DiskCache diskCache;
+        GLRegistry registry;
+        FrameCapture frameCapture;
+
+        void load(Script::ptr);
+        bool hot_swap(Script::ptr);
         Expr::ptr execute_stmts(Stmts::ptr);
         void prepare();
-        void load_imports();
-        void load_import(string);
         void execute_init();
         void execute_loop();
         void compile_program();
-        void compile_shader(GLuint*, Shader::ptr);
+        void compile_shader(GLuint*, Shader::ptr, const string&);
         void setFunctions(QOpenGLFunctions* gl) {
             #ifndef NO_GL
             this->gl = gl;
+            registry.open(gl);
+            diskCache.open(gl);
+            uniformBlocks.open(gl);
+            textures.open(gl);
+            renderTargets.open(gl);
+            frameCapture.open(gl);
             #endif
         }
         void reset();
         void resize(int, int);
+        // Starts reading back what was drawn to the screen into the next file of pattern; see FrameCapture
+        void capture_screen(const string& pattern);
+        // Texture memory held on the CPU (decoded pixels not uploaded yet) and on the GPU
+        string memory_report();
+        void set_time(float, float);
 
     private:
-        Wyatt::Scanner scanner;
-        Wyatt::Parser parser;
-
         Scope::ptr globalScope;
         std::stack<ScopeList::ptr> functionScopeStack;
         map<string, shared_ptr<ShaderPair>> shaders;
@@ -161,13 +202,42 @@ class Interpreter {
 
         vector<string> imports;
         vector<Decl::ptr> globals;
+        // What each list literal of constants evaluated to last, to reuse while nothing else holds it
+        map<List::ptr, List::ptr> constantLists;
 
-        int activeTextureSlot = 0;
+        // The texture bound to each unit, and the active unit, as far as this interpreter knows
+        map<int, GLuint> boundTextures;
+        int activeUnit = -1;
+        // Where drawing without a target goes
+        GLuint screenFramebuffer = 0;
 
         bool breakable = false;
+        // The values set_time() gave TIME and DELTA_TIME, to notice loop() reading them
+        Expr::ptr timeValue, deltaValue;
 
         string current_program_name;
         Program::ptr current_program = nullptr;
+        GLuint boundProgram = 0;
+        // Cache key of each shader pair's program
+        map<string, unsigned long long> programHashes;
+        // Cache key of each permutation built, by pair name and the hash of the constants picked
+        map<pair<string, unsigned long long>, unsigned long long> permutations;
+        // Programs that failed to link since the last reset(), so a permutation isn't rebuilt every frame
+        set<unsigned long long> failedPrograms;
+        // The pair whose uniforms each GL program holds; pairs with the same GLSL share one
+        map<GLuint, weak_ptr<Program>> uniformOwners;
+        // Set when the script picks a constant, so the current permutation is looked up again
+        bool stalePermutation = false;
+
+        // GL objects made for the script's buffers (image textures belong to the TextureCache,
+        // and the textures it draws into to the RenderTargetPool). They go back to the registry
+        // at the end of the frame their value went away in, and all of them on reset()
+        struct OwnedObject {
+            weak_ptr<Expr> value;
+            GLObjectKind kind;
+            GLuint name;
+        };
+        vector<OwnedObject> ownedObjects;
 
         FuncDef::ptr init = nullptr;
         FuncDef::ptr loop = nullptr;
@@ -186,13 +256,39 @@ class Interpreter {
         Expr::ptr invoke(shared_ptr<Invoke>);
         Expr::ptr eval_stmt(shared_ptr<Stmt>);
         Expr::ptr resolve_vector(vector<Expr::ptr>);
+        void sign(NodeType, const void*, size_t);
+        void use_program(GLuint);
+        void link_programs(const vector<string>&);
+        void defer_programs(const vector<string>&);
+        Program::ptr linked(Program::ptr);
+        void declare_program(const string&, Program::ptr);
+        Program::ptr build_program(unsigned long long, shared_ptr<ShaderPair>, const string&, const string&, bool&);
+        void check_program(Program::ptr, shared_ptr<ShaderPair>, unsigned long long);
+        Program::ptr specialize(Program::ptr);
+        Program::ptr permutation(Program::ptr);
+        Program::ptr build_permutation(Program::ptr, const string&, unsigned long long);
+        Shader::ptr specialize_shader(Shader::ptr, const map<string, Expr::ptr>&, unsigned long long);
+        Decl::ptr shader_constant(Program::ptr, const string&);
+        string uniform_type(Program::ptr, const string&);
+        bool upload_uniform(Dot::ptr, const string&, Expr::ptr);
+        void check_shader(GLuint, Shader::ptr);
+        void release_programs();
+        void upload_texture(Texture::ptr, int);
+        void apply_sampling(Texture::ptr, int);
+        void assign_samplers(Program::ptr);
+        void bind_textures(Program::ptr);
+        void bind_texture(int, GLuint);
+        void select_unit(int);
+        void find_screen();
+        void prepare_target(Texture::ptr);
+        void own(Expr::ptr, GLObjectKind, GLuint);
+        void release_objects(bool all = false);
+        pair<string, string> transpile(shared_ptr<ShaderPair>);
 
         LogWindow* logger;
-
-        GLSLTranspiler* transpiler;
-
-        unsigned int line = 1;
-        unsigned int column = 1;
+        UniformBlocks uniformBlocks;
+        TextureLoader textures;
+        RenderTargetPool renderTargets;
 };
 }
 
@@ -0,0 +1,57 @@
+#include "modulecache.h"
+
+#include "helper.h"
+#include "trace.h"
+
+namespace Wyatt {
+
+ModuleCache& ModuleCache::shared() {
+    static ModuleCache cache;
+    return cache;
+}
+
+Script::ptr ModuleCache::get(const string& path, LogWindow* logger) {
+    long long mtime = file_mtime(path);
+
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = modules.find(path);
+        if(it != modules.end() && it->second.mtime == mtime) {
+            hitCount++;
+            return it->second.script;
+        }
+    }
+
+    string src = str_from_file(path);
+    unsigned long long hash = hash_bytes(src.data(), src.size());
+
+    {
+        lock_guard<mutex> guard(lock);
+        auto it = modules.find(path);
+        if(it != modules.end() && it->second.hash == hash) {
+            // Touched but not changed
+            it->second.mtime = mtime;
+            hitCount++;
+            return it->second.script;
+        }
+    }
+
+    TRACE_SCOPE("parse", path);
+    Script::ptr script = make_shared<Script>(logger, "");
+    script->status = script->parse(src);
+    for(auto it = script->functions.begin(); it != script->functions.end(); ++it) {
+        it->second->source = path;
+    }
+
+    lock_guard<mutex> guard(lock);
+    modules[path] = { mtime, hash, script };
+    missCount++;
+    return script;
+}
+
+void ModuleCache::clear() {
+    lock_guard<mutex> guard(lock);
+    modules.clear();
+}
+
+}
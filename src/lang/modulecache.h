@@ -0,0 +1,44 @@
+#ifndef MODULECACHE_H
+#define MODULECACHE_H
+
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <string>
+
+#include "script.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// Imported files parsed once and shared by every reload that imports them. A cached module is
+// reused while its modification time is unchanged, or when it changed but its contents hash the same.
+// Cached trees are shared, so nothing may modify them once they're parsed
+class ModuleCache {
+    public:
+        static ModuleCache& shared();
+
+        // The parsed contents of path alone, without the files it imports in turn
+        Script::ptr get(const string& path, LogWindow* logger);
+        void clear();
+
+        unsigned int hits() const { return hitCount; }
+        unsigned int misses() const { return missCount; }
+
+    private:
+        struct Module {
+            long long mtime;
+            unsigned long long hash;
+            Script::ptr script;
+        };
+
+        mutex lock;
+        map<string, Module> modules;
+        atomic<unsigned int> hitCount{0};
+        atomic<unsigned int> missCount{0};
+};
+
+}
+
+#endif // MODULECACHE_H
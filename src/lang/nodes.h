@@ -6,15 +6,18 @@
 #include <map>
 #include <memory>
 #include <iostream>
+#include <atomic>
 #include <QOpenGLFunctions>
 
+#include "textureformat.h"
+
 using namespace std;
 
 enum NodeType {
     NODE_INVOKE,
-    NODE_EXPR, NODE_NULL, NODE_BINARY, NODE_UNARY, NODE_BOOL, NODE_INT, NODE_FLOAT, NODE_STRING, NODE_VECTOR2, NODE_VECTOR3, NODE_VECTOR4, NODE_MATRIX2, NODE_MATRIX3, NODE_MATRIX4, NODE_IDENT, NODE_DOT, NODE_BUFFER, NODE_TEXTURE, NODE_PROGRAM,
+    NODE_EXPR, NODE_NULL, NODE_BINARY, NODE_UNARY, NODE_BOOL, NODE_INT, NODE_FLOAT, NODE_STRING, NODE_VECTOR2, NODE_VECTOR3, NODE_VECTOR4, NODE_MATRIX2, NODE_MATRIX3, NODE_MATRIX4, NODE_IDENT, NODE_DOT, NODE_BUFFER, NODE_TEXTURE, NODE_PINGPONG, NODE_PROGRAM,
     NODE_UPLOADLIST, NODE_FUNCEXPR, NODE_LIST, NODE_ARGLIST, NODE_PARAMLIST, NODE_INDEX,
-    NODE_STMT, NODE_ASSIGN, NODE_DECL, NODE_ALLOC, NODE_COMPBINARY, NODE_UPLOAD, NODE_APPEND, NODE_DRAW, NODE_CLEAR, NODE_VIEWPORT, NODE_FUNCSTMT, NODE_STMTS, NODE_IF, NODE_WHILE, NODE_FOR, NODE_BREAK, NODE_SHADER, NODE_PRINT, NODE_FUNCDEF, NODE_RETURN
+    NODE_STMT, NODE_ASSIGN, NODE_DECL, NODE_ALLOC, NODE_COMPBINARY, NODE_UPLOAD, NODE_APPEND, NODE_DRAW, NODE_CLEAR, NODE_VIEWPORT, NODE_CAPTURE, NODE_FUNCSTMT, NODE_STMTS, NODE_IF, NODE_WHILE, NODE_FOR, NODE_BREAK, NODE_SHADER, NODE_PRINT, NODE_FUNCDEF, NODE_RETURN
 };
 
 inline string type_to_name(NodeType type) {
@@ -32,6 +35,7 @@ inline string type_to_name(NodeType type) {
         case NODE_MATRIX4: return "mat4";
         case NODE_BUFFER: return "buffer";
         case NODE_TEXTURE: return "texture2D";
+        case NODE_PINGPONG: return "pingpong";
         case NODE_PROGRAM: return "program";
         case NODE_NULL: return "null";
         default: return "undefined";
@@ -45,6 +49,9 @@ enum OpType {
 #define null_expr make_shared<Expr>(NODE_NULL)
 #define DEFINE_PTR(type) typedef shared_ptr<type> ptr;
 
+// Every node constructed so far, parsed or produced at runtime; defined in stats.cpp
+extern atomic<unsigned long long> node_allocations;
+
 class Node {
     public:
         DEFINE_PTR(Node)
@@ -53,7 +60,9 @@ class Node {
         unsigned int first_column, last_column;
         NodeType type;
 
-        Node(NodeType type): type(type) {}
+        Node(NodeType type): type(type) {
+            node_allocations.fetch_add(1, memory_order_relaxed);
+        }
 };
 
 class Expr: public Node {
@@ -372,10 +381,13 @@ class Buffer: public Expr {
     public:
         DEFINE_PTR(Buffer)
 
-        GLuint handle, indexHandle;
+        GLuint handle = 0;
+        // Only created once the buffer has indices to draw with
+        GLuint indexHandle = 0;
         map<string, vector<float>> data;
         map<string, unsigned int> sizes;
         vector<unsigned int> indices;
+        unsigned int revision = 0;
 
         Layout* layout;
 
@@ -386,6 +398,15 @@ class Buffer: public Expr {
         }
 };
 
+namespace Wyatt { struct CachedTexture; struct RenderTarget; }
+
+// How a GL texture is set up right now, shared by every texture2D showing it
+struct TextureState {
+    GLenum minFilter = 0, magFilter = 0, wrap = 0;
+    int levels = 1;
+    bool compressed = false;
+};
+
 class Texture: public Expr {
     public:
         DEFINE_PTR(Texture)
@@ -394,11 +415,49 @@ class Texture: public Expr {
         GLuint framebuffer;
 
         int width, height, channels;
-        unsigned char* image;
+        // Decoded pixels waiting to be uploaded; freed once they're on the GPU
+        shared_ptr<unsigned char> image;
+        // The compressed format of image and its mip levels, or 0 for RGBA pixels
+        GLenum format = 0;
+        vector<TextureLevel> levels;
+        // The image is still being decoded; see TextureLoader
+        bool loading = false;
+        // The file the image came from, and the TextureCache entry its handle belongs to once uploaded
+        string source;
+        long long mtime = -1;
+        shared_ptr<Wyatt::CachedTexture> cached;
+        // The framebuffer and texture it's drawn into, if it's a render target
+        shared_ptr<Wyatt::RenderTarget> target;
+
+        // Sampling the script asked for; applied when the texture is next bound
+        bool mipmaps = false;
+        string filter = "", wrap = "";
+        shared_ptr<TextureState> state;
 
         Texture(): Expr(NODE_TEXTURE) {
             handle = 0;
             framebuffer = 0;
+            width = height = channels = 0;
+            image = nullptr;
+        }
+};
+
+// Two render targets, one drawn into while the other is sampled. Every draw into it writes the
+// write side and then swaps them, so the result is always on the read side
+class PingPong: public Expr {
+    public:
+        DEFINE_PTR(PingPong)
+
+        Texture::ptr sides[2];
+        unsigned int current = 0;
+
+        Texture::ptr read() { return sides[current]; }
+        Texture::ptr write() { return sides[current ^ 1]; }
+        void swap() { current ^= 1; }
+
+        PingPong(): Expr(NODE_PINGPONG) {
+            sides[0] = make_shared<Texture>();
+            sides[1] = make_shared<Texture>();
         }
 };
 
@@ -406,6 +465,9 @@ class Stmt: public Node {
     public:
         DEFINE_PTR(Stmt)
 
+        // Hash of the source lines a top-level statement was parsed from; see Script::parse
+        unsigned long long digest = 0;
+
         Stmt(): Node(NODE_STMT) {}
         Stmt(NodeType type): Node(type) {}
 };
@@ -539,6 +601,8 @@ class FuncDef: public Stmt {
         Ident::ptr ident;
         ParamList::ptr params;
         Stmts::ptr stmts;
+        // File the function was imported from, empty if it's in the main program
+        string source = "";
 
         FuncDef(Ident::ptr ident, ParamList::ptr params, Stmts::ptr stmts): Stmt(NODE_FUNCDEF), ident(ident), params(params), stmts(stmts) {}
 };
@@ -591,10 +655,15 @@ class Draw: public Stmt {
         DEFINE_PTR(Draw)
 
         Ident::ptr ident;
-        Ident::ptr target;
+        // The textures drawn into, one per fragment shader output; none draws to the screen
+        vector<Ident::ptr> targets;
         Ident::ptr program;
 
-        Draw(Ident::ptr ident, Ident::ptr target = nullptr, Ident::ptr program = nullptr): Stmt(NODE_DRAW), ident(ident), target(target), program(program) {}
+        Draw(Ident::ptr ident, shared_ptr<vector<Ident::ptr>> targets = nullptr, Ident::ptr program = nullptr): Stmt(NODE_DRAW), ident(ident), program(program) {
+            if(targets != nullptr) {
+                this->targets = *targets;
+            }
+        }
 };
 
 class Clear: public Stmt {
@@ -615,6 +684,17 @@ class Viewport: public Stmt {
         Viewport(Expr::ptr bounds): Stmt(NODE_VIEWPORT), bounds(bounds) {}
 };
 
+class Capture: public Stmt {
+    public:
+        DEFINE_PTR(Capture)
+
+        // The texture2D or pingpong to read back; nullptr for the screen
+        Expr::ptr source;
+        Expr::ptr path;
+
+        Capture(Expr::ptr source, Expr::ptr path): Stmt(NODE_CAPTURE), source(source), path(path) {}
+};
+
 class Print: public Stmt {
     public:
         DEFINE_PTR(Print)
@@ -658,18 +738,27 @@ class Shader: public Node {
 
         string name;
         shared_ptr<map<string, string>> uniforms;
+        // Compile-time constants, by name; each program picks its own values, see Interpreter::specialize
+        shared_ptr<map<string, Decl::ptr>> constants;
         shared_ptr<vector<string>> textureSlots;
         shared_ptr<map<string, FuncDef::ptr>> functions;
         ParamList::ptr inputs;
         ParamList::ptr outputs;
+        unsigned long long digest = 0;
 
-        Shader(string name, shared_ptr<vector<pair<string, string>>> uniforms, shared_ptr<map<string, FuncDef::ptr>> functions, ParamList::ptr inputs, ParamList::ptr outputs): Node(NODE_SHADER), name(name) {
+        Shader(string name, shared_ptr<vector<Decl::ptr>> uniforms, shared_ptr<map<string, FuncDef::ptr>> functions, ParamList::ptr inputs, ParamList::ptr outputs): Node(NODE_SHADER), name(name) {
             this->uniforms = make_shared<map<string, string>>();
+            this->constants = make_shared<map<string, Decl::ptr>>();
             this->textureSlots = make_shared<vector<string>>();
             for(auto it = uniforms->begin(); it != uniforms->end(); ++it) {
-                this->uniforms->insert(pair<string, string>(it->first, it->second));
-                if(it->second == "texture2D") {
-                    this->textureSlots->push_back(it->first);
+                Decl::ptr decl = *it;
+                if(decl->constant) {
+                    this->constants->insert(pair<string, Decl::ptr>(decl->ident->name, decl));
+                    continue;
+                }
+                this->uniforms->insert(pair<string, string>(decl->ident->name, decl->datatype->name));
+                if(decl->datatype->name == "texture2D") {
+                    this->textureSlots->push_back(decl->ident->name);
                 }
             }
             this->functions = functions;
@@ -682,9 +771,25 @@ class Program: public Expr {
     public:
         DEFINE_PTR(Program)
 
-        GLuint handle;
-        GLuint vert, frag;
+        GLuint handle = 0;
+        // Both 0 when the program was restored from a binary
+        GLuint vert = 0, frag = 0;
         Shader::ptr vertSource, fragSource;
+        // A placeholder with no GL program yet; see Interpreter::defer_programs
+        bool deferred = false;
+
+        // Values the script gave the shaders' constants; the permutation built for them is active
+        map<string, Expr::ptr> selection;
+        Program::ptr active = nullptr;
+        // This pair's own wrapper of each permutation built for it, by the hash of the constants picked
+        map<unsigned long long, Program::ptr> variants;
+        // Every uniform the script set, so a permutation it switches to can be given the same values
+        map<string, pair<Dot::ptr, Expr::ptr>> uniformValues;
+        // The texture2D or pingpong assigned to each sampler unit (nullptr for none), bound when
+        // drawing with the program
+        map<int, Expr::ptr> textures;
+        // The handle the sampler uniforms were last pointed at their units for
+        GLuint samplersHandle = 0;
 
         Program(): Expr(NODE_PROGRAM) {}
 };
@@ -695,6 +800,8 @@ class ProgramLayout: public Stmt {
 
         Ident::ptr ident;
         shared_ptr<vector<Decl::ptr>> attribs;
+        // Declared with `uniform` rather than `layout`: a block of uniforms shared by every shader that names it
+        bool uniform = false;
 };
 
 struct ShaderPair {
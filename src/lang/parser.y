@@ -106,8 +106,10 @@
 %token USING "using";
 %token CLEAR "clear";
 %token VIEWPORT "viewport";
+%token CAPTURE "capture";
 %token CONST "const";
 %token LAYOUT "layout";
+%token UNIFORM "uniform";
 %token VERTEX "vert";
 %token FRAGMENT "frag";
 %token MAIN "main";
@@ -130,9 +132,10 @@
 %type<Dot::ptr> dot;
 %type<List::ptr> list;
 %type<Decl::ptr> decl;
-%type<shared_ptr<vector<pair<string, string>>>> shader_uniforms;
+%type<shared_ptr<vector<shared_ptr<Decl>>>> shader_uniforms;
 %type<shared_ptr<map<string, FuncDef::ptr>>> shader_functions;
 %type<shared_ptr<vector<shared_ptr<Decl>>>> layout_attribs;    
+%type<shared_ptr<vector<Ident::ptr>>> draw_targets;
 %type<ProgramLayout::ptr> layout;
 
 %type<Stmt::ptr> stmt stmt_block
@@ -166,12 +169,14 @@ body:
     |
     decl EQUALS expr SEMICOLON body {
         $1->value = $3;
+        set_lines($1, @1, @3);
         globals->push_back($1);
     }
     |
     CONST decl EQUALS expr SEMICOLON body {
         $2->value = $4;
         $2->constant = true;
+        set_lines($2, @1, @4);
         globals->push_back($2);
     }
     |
@@ -212,8 +217,16 @@ body:
     }
     ;
     
-shader_uniforms: { $$ = make_shared<vector<pair<string, string>>>(); }
-    | shader_uniforms decl SEMICOLON { $$ = $1; $1->push_back(pair<string, string>($2->ident->name, $2->datatype->name)); }
+shader_uniforms: { $$ = make_shared<vector<Decl::ptr>>(); }
+    | shader_uniforms decl SEMICOLON { $$ = $1; $1->push_back($2); }
+    | shader_uniforms UNIFORM IDENTIFIER SEMICOLON { $$ = $1; $1->push_back(make_shared<Decl>(make_shared<Ident>("uniform"), $3, nullptr)); }
+    | shader_uniforms CONST decl EQUALS expr SEMICOLON {
+        $$ = $1;
+        $3->value = $5;
+        $3->constant = true;
+        set_lines($3, @2, @5);
+        $1->push_back($3);
+    }
     ;
 
 shader_functions: FUNC MAIN OPEN_PAREN CLOSE_PAREN block { $$ = make_shared<map<string, FuncDef::ptr>>(); $$->insert(pair<string, FuncDef::ptr>("main", make_shared<FuncDef>(make_shared<Ident>("main"), make_shared<ParamList>(nullptr), $5)));}
@@ -224,6 +237,14 @@ layout: LAYOUT IDENTIFIER OPEN_BRACE layout_attribs CLOSE_BRACE {
         $$ = make_shared<ProgramLayout>();
         $$->ident = $2;
         $$->attribs = $4;
+        set_lines($$, @1, @5);
+    }
+    | UNIFORM IDENTIFIER OPEN_BRACE layout_attribs CLOSE_BRACE {
+        $$ = make_shared<ProgramLayout>();
+        $$->ident = $2;
+        $$->attribs = $4;
+        $$->uniform = true;
+        set_lines($$, @1, @5);
     }
     ;
 
@@ -236,10 +257,12 @@ layout_attribs: { $$ = make_shared<vector<Decl::ptr>>(); }
 
 vert_shader: VERTEX IDENTIFIER OPEN_PAREN param_list CLOSE_PAREN OPEN_BRACE shader_uniforms shader_functions CLOSE_BRACE OPEN_PAREN param_list CLOSE_PAREN {
         $$ = make_shared<Shader>($2->name, $7, $8, $4, $11);
+        set_lines($$, @1, @12);
     }
     ;
 frag_shader: FRAGMENT IDENTIFIER OPEN_PAREN param_list CLOSE_PAREN OPEN_BRACE shader_uniforms shader_functions CLOSE_BRACE OPEN_PAREN param_list CLOSE_PAREN {
         $$ = make_shared<Shader>($2->name, $7, $8, $4, $11);
+        set_lines($$, @1, @12);
     }
     ;
 
@@ -288,6 +311,10 @@ dot: IDENTIFIER PERIOD IDENTIFIER { $$ = make_shared<Dot>($1, $3); set_lines($$,
 decl: IDENTIFIER IDENTIFIER { $$ = make_shared<Decl>($1, $2, nullptr); set_lines($$, @1, @2); }
     ;
 
+draw_targets: IDENTIFIER { $$ = make_shared<vector<Ident::ptr>>(); $$->push_back($1); }
+    | draw_targets COMMA IDENTIFIER { $1->push_back($3); $$ = $1; }
+    ;
+
 stmt: IDENTIFIER EQUALS expr { $$ = make_shared<Assign>($1, $3); set_lines($$, @1, @3); }
     | decl { $$ = $1; }
     | decl EQUALS expr { $$ = $1; $1->value = $3; set_lines($$, @1, @3); }
@@ -298,10 +325,12 @@ stmt: IDENTIFIER EQUALS expr { $$ = make_shared<Assign>($1, $3); set_lines($$, @
     | CLEAR { $$ = make_shared<Clear>(nullptr); set_lines($$, @1, @1); }
     | CLEAR expr { $$ = make_shared<Clear>($2); set_lines($$, @1, @2); }
     | VIEWPORT expr { $$ = make_shared<Viewport>($2); set_lines($$, @1, @2); }
+    | CAPTURE expr { $$ = make_shared<Capture>(nullptr, $2); set_lines($$, @1, @2); }
+    | CAPTURE expr TO expr { $$ = make_shared<Capture>($2, $4); set_lines($$, @1, @4); }
     | DRAW IDENTIFIER { $$ = make_shared<Draw>($2); set_lines($$, @1, @2); }
-    | DRAW IDENTIFIER TO IDENTIFIER { $$ = make_shared<Draw>($2, $4); set_lines($$, @1, @4); }
+    | DRAW IDENTIFIER TO draw_targets { $$ = make_shared<Draw>($2, $4); set_lines($$, @1, @4); }
     | DRAW IDENTIFIER USING IDENTIFIER { $$ = make_shared<Draw>($2, nullptr, $4); set_lines($$, @1, @4); }
-    | DRAW IDENTIFIER TO IDENTIFIER USING IDENTIFIER { $$ = make_shared<Draw>($2, $4, $6); set_lines($$, @1, @6); }
+    | DRAW IDENTIFIER TO draw_targets USING IDENTIFIER { $$ = make_shared<Draw>($2, $4, $6); set_lines($$, @1, @6); }
     | PRINT expr { $$ = make_shared<Print>($2); set_lines($$, @1, @2); }
     | RETURN expr { $$ = make_shared<Return>($2); set_lines($$, @1, @2); }
     | BREAK { $$ = make_shared<Break>(); set_lines($$, @1, @1); }
@@ -342,14 +371,14 @@ stmt_block: if_stmt { $$ = $1; }
     | if_stmt else_if_chain { $$ = $1; $1->elseIfBlocks = $2; }
     | if_stmt else_if_chain ELSE stmt SEMICOLON { $$ = $1; $1->elseIfBlocks = $2; $1->elseBlock = make_shared<Stmts>($4); }
     | if_stmt else_if_chain ELSE block { $$ = $1; $1->elseIfBlocks = $2; $1->elseBlock = $4; }
-    | WHILE OPEN_PAREN expr CLOSE_PAREN block { $$ = make_shared<While>($3, $5); }
-    | FOR OPEN_PAREN IDENTIFIER IN expr COMMA expr COMMA expr CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7, $9, $11); }
-    | FOR OPEN_PAREN IDENTIFIER IN IDENTIFIER CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7); }
-    | FOR OPEN_PAREN IDENTIFIER IN dot CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7); }
+    | WHILE OPEN_PAREN expr CLOSE_PAREN block { $$ = make_shared<While>($3, $5); set_lines($$, @1, @5); }
+    | FOR OPEN_PAREN IDENTIFIER IN expr COMMA expr COMMA expr CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7, $9, $11); set_lines($$, @1, @11); }
+    | FOR OPEN_PAREN IDENTIFIER IN IDENTIFIER CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7); set_lines($$, @1, @7); }
+    | FOR OPEN_PAREN IDENTIFIER IN dot CLOSE_PAREN block { $$ = make_shared<For>($3, $5, $7); set_lines($$, @1, @7); }
     ;
 
-if_stmt: IF OPEN_PAREN expr CLOSE_PAREN block { $$ = make_shared<If>($3, $5); }
-    | IF OPEN_PAREN expr CLOSE_PAREN stmt SEMICOLON { $$ = make_shared<If>($3, make_shared<Stmts>($5)); }
+if_stmt: IF OPEN_PAREN expr CLOSE_PAREN block { $$ = make_shared<If>($3, $5); set_lines($$, @1, @5); }
+    | IF OPEN_PAREN expr CLOSE_PAREN stmt SEMICOLON { $$ = make_shared<If>($3, make_shared<Stmts>($5)); set_lines($$, @1, @6); }
    ;
 
 else_if_chain: else_if_stmt { $$ = make_shared<vector<If::ptr>>(); $$->push_back($1); }
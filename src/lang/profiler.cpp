@@ -0,0 +1,77 @@
+#include "profiler.h"
+
+namespace Wyatt {
+
+void Profiler::clear() {
+    functions.clear();
+    lines.clear();
+    frames = 0;
+    stack.clear();
+    functionFrames.clear();
+    depth.clear();
+}
+
+void Profiler::enter_function(const string& name, bool local) {
+    functionFrames.push_back(stack.size());
+    depth[name]++;
+    stack.push_back({ true, local, name, 0, chrono::steady_clock::now(), 0, 0 });
+}
+
+void Profiler::exit_function() {
+    if(stack.empty() || !stack.back().function) {
+        return;
+    }
+
+    Frame frame = stack.back();
+    stack.pop_back();
+    functionFrames.pop_back();
+
+    double elapsed;
+    exit(frame, elapsed);
+
+    FunctionProfile& profile = functions[frame.name];
+    profile.calls++;
+    profile.exclusiveMs += elapsed - frame.calleeMs;
+    // A recursive call is already inside the outermost call's inclusive time
+    if(--depth[frame.name] == 0) {
+        profile.inclusiveMs += elapsed;
+    }
+
+    if(!functionFrames.empty()) {
+        stack[functionFrames.back()].calleeMs += elapsed;
+    }
+}
+
+bool Profiler::enter_line(unsigned int line) {
+    if(!functionFrames.empty() && !stack[functionFrames.back()].local) {
+        return false;
+    }
+
+    stack.push_back({ false, true, "", line, chrono::steady_clock::now(), 0, 0 });
+    return true;
+}
+
+void Profiler::exit_line() {
+    if(stack.empty() || stack.back().function) {
+        return;
+    }
+
+    Frame frame = stack.back();
+    stack.pop_back();
+
+    double elapsed;
+    exit(frame, elapsed);
+
+    LineProfile& profile = lines[frame.line];
+    profile.hits++;
+    profile.selfMs += elapsed - frame.childMs;
+}
+
+void Profiler::exit(Frame& frame, double& elapsed) {
+    elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - frame.start).count();
+    if(!stack.empty()) {
+        stack.back().childMs += elapsed;
+    }
+}
+
+}
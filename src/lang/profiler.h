@@ -0,0 +1,64 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <chrono>
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Wyatt {
+
+struct FunctionProfile {
+    unsigned long long calls = 0;
+    // Inclusive time counts callees, exclusive time doesn't
+    double inclusiveMs = 0;
+    double exclusiveMs = 0;
+};
+
+struct LineProfile {
+    unsigned long long hits = 0;
+    // Time spent on the line itself, not in statements nested under it or in functions it calls
+    double selfMs = 0;
+};
+
+// Accumulates where script time goes. The interpreter only calls into it while enabled is set,
+// so a disabled profiler costs one branch per statement and per call
+class Profiler {
+    public:
+        bool enabled = false;
+
+        map<string, FunctionProfile> functions;
+        map<unsigned int, LineProfile> lines;
+        unsigned int frames = 0;
+
+        void clear();
+
+        // Lines are only recorded inside functions from the main file; imported code has its own numbering
+        void enter_function(const string& name, bool local);
+        void exit_function();
+        bool enter_line(unsigned int line);
+        void exit_line();
+
+    private:
+        struct Frame {
+            bool function;
+            bool local;
+            string name;
+            unsigned int line;
+            chrono::steady_clock::time_point start;
+            double childMs;
+            double calleeMs;
+        };
+
+        vector<Frame> stack;
+        vector<unsigned int> functionFrames;
+        map<string, unsigned int> depth;
+
+        void exit(Frame&, double&);
+};
+
+}
+
+#endif // PROFILER_H
@@ -0,0 +1,41 @@
+#include "programcache.h"
+
+namespace Wyatt {
+
+Program::ptr ProgramCache::find(unsigned long long hash) {
+    auto it = programs.find(hash);
+    if(it == programs.end()) {
+        missCount++;
+        return nullptr;
+    }
+    hitCount++;
+    return it->second;
+}
+
+void ProgramCache::insert(unsigned long long hash, Program::ptr program) {
+    programs[hash] = program;
+}
+
+vector<Program::ptr> ProgramCache::sweep(const set<unsigned long long>& live) {
+    vector<Program::ptr> unused;
+    for(auto it = programs.begin(); it != programs.end();) {
+        if(live.find(it->first) == live.end()) {
+            unused.push_back(it->second);
+            it = programs.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    return unused;
+}
+
+vector<Program::ptr> ProgramCache::clear() {
+    vector<Program::ptr> all;
+    for(auto it = programs.begin(); it != programs.end(); ++it) {
+        all.push_back(it->second);
+    }
+    programs.clear();
+    return all;
+}
+
+}
@@ -0,0 +1,38 @@
+#ifndef PROGRAMCACHE_H
+#define PROGRAMCACHE_H
+
+#include <map>
+#include <set>
+#include <vector>
+
+#include "nodes.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// Linked programs kept across reloads, keyed by a hash of their transpiled vertex and fragment
+// GLSL. Layouts are part of that source, so a layout edit is a different key too. Only the GL
+// program is shared: each pair the script declares gets a Program of its own, with its handle
+class ProgramCache {
+    public:
+        Program::ptr find(unsigned long long hash);
+        void insert(unsigned long long hash, Program::ptr program);
+        // Forgets every program whose hash isn't in live and hands it back so its GL objects can be deleted
+        vector<Program::ptr> sweep(const set<unsigned long long>& live);
+        // Hands back everything, e.g. when the GL context goes away
+        vector<Program::ptr> clear();
+
+        unsigned int size() const { return programs.size(); }
+        unsigned int hits() const { return hitCount; }
+        unsigned int misses() const { return missCount; }
+
+    private:
+        map<unsigned long long, Program::ptr> programs;
+        unsigned int hitCount = 0;
+        unsigned int missCount = 0;
+};
+
+}
+
+#endif // PROGRAMCACHE_H
@@ -0,0 +1,167 @@
+#include "rendertargetpool.h"
+
+#include <algorithm>
+
+#include <QOpenGLContext>
+
+#ifndef GL_MAX_DRAW_BUFFERS
+#define GL_MAX_DRAW_BUFFERS 0x8824
+#endif
+
+namespace Wyatt {
+
+RenderTargetPool::RenderTargetPool(GLRegistry* registry): registry(registry) {}
+
+void RenderTargetPool::open(QOpenGLFunctions* gl) {
+    this->gl = gl;
+    drawBuffers = nullptr;
+    maxDrawBuffers = 1;
+
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context != nullptr) {
+        drawBuffers = (DrawBuffers) context->getProcAddress("glDrawBuffers");
+    }
+    if(drawBuffers != nullptr) {
+        gl->glGetIntegerv(GL_MAX_DRAW_BUFFERS, &maxDrawBuffers);
+    }
+}
+
+RenderTargetPool::Target RenderTargetPool::acquire(int width, int height, GLenum format) {
+    for(auto it = targets.begin(); it != targets.end(); ++it) {
+        RenderTarget& target = **it;
+        // Only the pool refers to it
+        if(it->use_count() == 1 && target.width == width && target.height == height && target.format == format) {
+            target.stale = false;
+            gl->glBindFramebuffer(GL_FRAMEBUFFER, target.framebuffer);
+            return *it;
+        }
+    }
+
+    Target target = make_shared<RenderTarget>();
+    target->width = width;
+    target->height = height;
+    target->format = format;
+    target->state = make_shared<TextureState>();
+    target->state->minFilter = GL_LINEAR;
+    target->state->magFilter = GL_LINEAR;
+    target->state->wrap = GL_REPEAT;
+    target->framebuffer = registry->create(OBJECT_FRAMEBUFFER);
+
+    bool reused;
+    target->texture = registry->create_texture(width, height, format, reused);
+    gl->glBindTexture(GL_TEXTURE_2D, target->texture);
+    if(!reused) {
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, format, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, NULL);
+    }
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_REPEAT);
+    gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_REPEAT);
+    gl->glBindTexture(GL_TEXTURE_2D, 0);
+
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, target->framebuffer);
+    gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, target->texture, 0);
+
+    targets.push_back(target);
+    createdCount++;
+    return target;
+}
+
+bool RenderTargetPool::combine(const vector<Target>& targets) {
+    if(drawBuffers == nullptr || (GLint) targets.size() > maxDrawBuffers) {
+        return false;
+    }
+
+    vector<GLuint> textures;
+    for(auto it = targets.begin(); it != targets.end(); ++it) {
+        textures.push_back((*it)->texture);
+    }
+    auto found = combined.find(textures);
+    if(found != combined.end()) {
+        gl->glBindFramebuffer(GL_FRAMEBUFFER, found->second);
+        return true;
+    }
+
+    GLuint framebuffer = registry->create(OBJECT_FRAMEBUFFER);
+    gl->glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+    vector<GLenum> buffers;
+    for(unsigned int i = 0; i < textures.size(); i++) {
+        gl->glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0 + i, GL_TEXTURE_2D, textures[i], 0);
+        buffers.push_back(GL_COLOR_ATTACHMENT0 + i);
+    }
+    // Which outputs go where is part of the framebuffer's state, so this is only done once
+    drawBuffers(buffers.size(), &buffers[0]);
+    combined[textures] = framebuffer;
+    return true;
+}
+
+void RenderTargetPool::collect() {
+    for(auto it = targets.begin(); it != targets.end();) {
+        if(it->use_count() > 1) {
+            (*it)->stale = false;
+            ++it;
+        } else
+        if((*it)->stale) {
+            destroy(*it);
+            it = targets.erase(it);
+        } else {
+            (*it)->stale = true;
+            ++it;
+        }
+    }
+}
+
+void RenderTargetPool::resize(int width, int height) {
+    screenWidth = width;
+    screenHeight = height;
+    for(auto it = targets.begin(); it != targets.end();) {
+        if(it->use_count() == 1 && ((*it)->width != width || (*it)->height != height)) {
+            destroy(*it);
+            it = targets.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+void RenderTargetPool::clear() {
+    for(auto it = targets.begin(); it != targets.end(); ++it) {
+        destroy(*it);
+    }
+    targets.clear();
+    combined.clear();
+    createdCount = 0;
+}
+
+// Targets of the screen's size are likely to be asked for again, e.g. after a reload, so the
+// registry pools them; any other size is deleted
+void RenderTargetPool::destroy(Target target) {
+    // Framebuffers combining it with others are of no use without it
+    for(auto it = combined.begin(); it != combined.end();) {
+        if(find(it->first.begin(), it->first.end(), target->texture) != it->first.end()) {
+            registry->release(OBJECT_FRAMEBUFFER, it->second);
+            it = combined.erase(it);
+        } else {
+            ++it;
+        }
+    }
+    if(target->width == screenWidth && target->height == screenHeight) {
+        registry->release(OBJECT_FRAMEBUFFER, target->framebuffer);
+        registry->release(OBJECT_TEXTURE, target->texture);
+    } else {
+        registry->discard(OBJECT_FRAMEBUFFER, target->framebuffer);
+        registry->discard(OBJECT_TEXTURE, target->texture);
+    }
+    target->framebuffer = 0;
+    target->texture = 0;
+}
+
+unsigned long long RenderTargetPool::bytes() const {
+    unsigned long long total = 0;
+    for(auto it = targets.begin(); it != targets.end(); ++it) {
+        total += (unsigned long long) (*it)->width * (*it)->height * 4;
+    }
+    return total;
+}
+
+}
@@ -0,0 +1,77 @@
+#ifndef RENDERTARGETPOOL_H
+#define RENDERTARGETPOOL_H
+
+#include <map>
+#include <memory>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+#include "nodes.h"
+#include "glregistry.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// A framebuffer with a texture attached as its colour buffer. Every texture2D drawn into holds one
+struct RenderTarget {
+    GLuint framebuffer = 0, texture = 0;
+    int width = 0, height = 0;
+    GLenum format = 0;
+    shared_ptr<TextureState> state;
+    // Not handed out during the last frame
+    bool stale = false;
+};
+
+// The textures scripts draw into, keyed by size and format. A target goes back to the pool once no
+// texture2D holds it, and the next one asking for the same size gets it instead of a new one, so a
+// target declared inside loop() is the same one every frame. Targets of another size than the
+// screen's are dropped when the window is resized, and texture2Ds still holding one are given a
+// new target the next time they're drawn into
+class RenderTargetPool {
+    public:
+        typedef shared_ptr<RenderTarget> Target;
+
+        RenderTargetPool(GLRegistry*);
+
+        void open(QOpenGLFunctions* gl);
+
+        // A target nothing else holds, with its framebuffer left bound
+        Target acquire(int width, int height, GLenum format);
+        // Binds a framebuffer drawing into every target's texture at once, the first one's at
+        // GL_COLOR_ATTACHMENT0 and so on, made the first time that list is drawn into. Returns false
+        // when the context can't draw into that many
+        bool combine(const vector<Target>& targets);
+        // Frees the targets that weren't asked for during the last frame; called once per frame
+        void collect();
+        // Frees the idle targets no longer matching the screen
+        void resize(int width, int height);
+        // Frees every target and zeroes them, e.g. on reset; texture2Ds still holding one are
+        // given a new one when next drawn into
+        void clear();
+
+        unsigned long long bytes() const;
+        unsigned int size() const { return targets.size(); }
+        // Targets acquire() had to create, rather than take from the pool, since the last clear()
+        unsigned int created() const { return createdCount; }
+
+    private:
+        typedef void (QOPENGLF_APIENTRYP DrawBuffers)(GLsizei, const GLenum*);
+
+        GLRegistry* registry;
+        QOpenGLFunctions* gl = nullptr;
+        DrawBuffers drawBuffers = nullptr;
+        GLint maxDrawBuffers = 1;
+        vector<Target> targets;
+        // Framebuffers made by combine(), by the textures attached to them
+        map<vector<GLuint>, GLuint> combined;
+        int screenWidth = 0, screenHeight = 0;
+        unsigned int createdCount = 0;
+
+        void destroy(Target target);
+};
+
+}
+
+#endif // RENDERTARGETPOOL_H
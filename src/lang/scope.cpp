@@ -1,9 +1,7 @@
 #include "scope.h"
 
-#include <stb_image.h>
-
 namespace Wyatt {
-    Scope::Scope(string name, LogWindow* logger, string* workingDir): name(name), logger(logger), workingDir(workingDir) {}
+    Scope::Scope(string name, LogWindow* logger, string* workingDir, TextureLoader* textures): name(name), logger(logger), workingDir(workingDir), textures(textures) {}
 
     void Scope::clear() {
         variables.clear();
@@ -54,13 +52,7 @@ namespace Wyatt {
                 } else {
                     realfilename = filename;
                 }
-                tex->image = stbi_load(realfilename.c_str(), &(tex->width), &(tex->height), &(tex->channels), 4);
-                if(tex->image == 0) {
-                    string message = "Cannot load " + filename + ": ";
-                    message += stbi_failure_reason();
-                    logger->log(assign, "ERROR", message);
-                    return true;
-                }
+                textures->load(tex, realfilename, assign);
                 variables[name] = tex;
                 return true;
             } else
@@ -86,6 +78,12 @@ namespace Wyatt {
         variables[name] = value;
     }
 
+    void Scope::forget(string name) {
+        variables.erase(name);
+        types.erase(name);
+        constants.erase(name);
+    }
+
     Expr::ptr Scope::get(string name) {
         if(variables.find(name) != variables.end()) {
             return variables[name];
@@ -7,6 +7,7 @@
 #include "logwindow.h"
 #include "nodes.h"
 #include "helper.h"
+#include "textureloader.h"
 
 namespace Wyatt {
 
@@ -17,14 +18,16 @@ class Scope {
         string name;
         LogWindow* logger;
         string* workingDir;
+        TextureLoader* textures;
 
-        Scope(string name, LogWindow* logger, string* workingDir);
+        Scope(string name, LogWindow* logger, string* workingDir, TextureLoader* textures);
 
         void clear();
         void declare(Stmt::ptr decl, Ident::ptr ident, string type, Expr::ptr value);
         void declare_const(string type, Expr::ptr value);
         bool assign(Stmt::ptr assign, Ident::ptr ident, Expr::ptr value);
         void fast_assign(string name, Expr::ptr value);
+        void forget(string name);
 
         Expr::ptr get(string name);
 
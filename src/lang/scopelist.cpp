@@ -2,7 +2,7 @@
 
 namespace Wyatt {
 
-ScopeList::ScopeList(string name, LogWindow* logger, string* workingDir): name(name), logger(logger), workingDir(workingDir)
+ScopeList::ScopeList(string name, LogWindow* logger, string* workingDir, TextureLoader* textures): name(name), logger(logger), workingDir(workingDir), textures(textures)
 {
     attach("base");
 }
@@ -12,7 +12,7 @@ Scope::ptr ScopeList::current() {
 }
 
 Scope::ptr ScopeList::attach(string name) {
-    Scope::ptr newScope = make_shared<Scope>(name, logger, workingDir);
+    Scope::ptr newScope = make_shared<Scope>(name, logger, workingDir, textures);
     chain.push_back(newScope);
     return newScope;
 }
@@ -16,8 +16,9 @@ class ScopeList {
         string name;
         LogWindow* logger;
         string* workingDir;
+        TextureLoader* textures;
 
-        ScopeList(string name, LogWindow* logger, string* workingDir);
+        ScopeList(string name, LogWindow* logger, string* workingDir, TextureLoader* textures);
 
         Scope::ptr current();
         Scope::ptr attach(string name);
@@ -0,0 +1,123 @@
+#include "script.h"
+
+#include <set>
+#include <sstream>
+
+#include "scanner.h"
+#include "parser.hpp"
+#include "helper.h"
+#include "modulecache.h"
+#include "trace.h"
+
+namespace Wyatt {
+
+Script::Script(LogWindow* logger, string workingDir): workingDir(workingDir), logger(logger) {}
+
+Script::ptr Script::build(string code, string workingDir, LogWindow* logger) {
+    Script::ptr script = make_shared<Script>(logger, workingDir);
+    script->status = script->parse(code);
+    script->load_imports();
+    return script;
+}
+
+int Script::parse(string code) {
+    TRACE_SCOPE("parse", "parse");
+    istringstream ss(code);
+    line = 1;
+    column = 1;
+
+    Scanner scanner(&line, &column);
+    Parser parser(scanner, logger, &line, &column, &imports, &globals, &functions, &layouts, &shaders);
+    scanner.switch_streams(&ss, nullptr);
+    int result = parser.parse();
+
+    // Hot reload compares these to find what an edit touched. The text is hashed rather than the
+    // tree so that moving code around without changing it doesn't count as a change
+    vector<string> lines;
+    istringstream text(code);
+    for(string l; getline(text, l);) {
+        lines.push_back(l);
+    }
+    for(auto it = globals.begin(); it != globals.end(); ++it) {
+        (*it)->digest = digest(lines, *it);
+    }
+    for(auto it = functions.begin(); it != functions.end(); ++it) {
+        it->second->digest = digest(lines, it->second);
+    }
+    for(auto it = layouts.begin(); it != layouts.end(); ++it) {
+        it->second->digest = digest(lines, it->second);
+    }
+    for(auto it = shaders.begin(); it != shaders.end(); ++it) {
+        if(it->second->vertex) {
+            it->second->vertex->digest = digest(lines, it->second->vertex);
+        }
+        if(it->second->fragment) {
+            it->second->fragment->digest = digest(lines, it->second->fragment);
+        }
+    }
+
+    return result;
+}
+
+unsigned long long Script::digest(const vector<string>& lines, Node::ptr node) {
+    unsigned long long hash = HASH_SEED;
+    for(unsigned int i = node->first_line; i <= node->last_line && i <= lines.size(); i++) {
+        hash = hash_bytes(lines[i - 1].data(), lines[i - 1].size(), hash);
+        hash = hash_bytes("\n", 1, hash);
+    }
+    return hash;
+}
+
+void Script::load_imports() {
+    TRACE_SCOPE("parse", "load_imports");
+    set<string> loaded;
+    for(unsigned int i = 0; i < imports.size(); i++) {
+        string file = imports[i];
+        if(loaded.insert(file).second) {
+            load_import(file);
+        }
+    }
+}
+
+void Script::load_import(string file) {
+    string path = file;
+    if(file_exists(workingDir + "/" + file)) {
+        path = workingDir + "/" + file;
+    }
+
+    // The module is shared with every other script importing the same file, so its nodes are
+    // referenced from here but its containers are copied
+    Script::ptr module = ModuleCache::shared().get(path, logger);
+    if(module->status != 0) {
+        logger->log("Error importing " + file);
+    }
+
+    for(auto it = module->functions.begin(); it != module->functions.end(); ++it) {
+        if(functions.find(it->first) == functions.end()) {
+            functions.insert(*it);
+        } else {
+            logger->log(it->second, "ERROR", "Redefinition of function " + it->first);
+        }
+    }
+    for(auto it = module->layouts.begin(); it != module->layouts.end(); ++it) {
+        layouts.insert(*it);
+    }
+    for(auto it = module->shaders.begin(); it != module->shaders.end(); ++it) {
+        ShaderPair::ptr pair = it->second;
+        if(shaders.find(it->first) == shaders.end()) {
+            ShaderPair::ptr copy = make_shared<ShaderPair>(*pair);
+            shaders.insert(make_pair(it->first, copy));
+        } else {
+            if(pair->vertex) {
+                shaders[it->first]->vertex = pair->vertex;
+            }
+            if(pair->fragment) {
+                shaders[it->first]->fragment = pair->fragment;
+            }
+        }
+    }
+    globals.insert(globals.end(), module->globals.begin(), module->globals.end());
+    imports.insert(imports.end(), module->imports.begin(), module->imports.end());
+}
+
+}
@@ -0,0 +1,52 @@
+#ifndef SCRIPT_H
+#define SCRIPT_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "nodes.h"
+#include "logwindow.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// Everything parsing a program and its imports produces, before any of it touches GL. Parsing
+// uses its own scanner and parser, so scripts can be built on a worker thread while the
+// interpreter keeps running the previous one
+class Script {
+    public:
+        DEFINE_PTR(Script)
+
+        Script(LogWindow* logger, string workingDir);
+
+        int status = -1;
+        string workingDir;
+
+        vector<string> imports;
+        vector<Decl::ptr> globals;
+        map<string, FuncDef::ptr> functions;
+        map<string, ProgramLayout::ptr> layouts;
+        map<string, ShaderPair::ptr> shaders;
+
+        // Parses the main program and then every file it imports
+        static Script::ptr build(string code, string workingDir, LogWindow* logger);
+
+        int parse(string code);
+        void load_imports();
+        void load_import(string file);
+
+    private:
+        LogWindow* logger;
+
+        static unsigned long long digest(const vector<string>& lines, Node::ptr node);
+
+        unsigned int line = 1;
+        unsigned int column = 1;
+};
+
+}
+
+#endif // SCRIPT_H
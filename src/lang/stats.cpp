@@ -0,0 +1,168 @@
+#include "stats.h"
+
+#include <algorithm>
+#include <cstdio>
+
+#include "nodes.h"
+
+atomic<unsigned long long> node_allocations(0);
+
+namespace Wyatt {
+
+TimingHistogram::TimingHistogram(unsigned int capacity): capacity(capacity) {
+    samples.reserve(capacity);
+}
+
+void TimingHistogram::add(double ms) {
+    if(samples.size() < capacity) {
+        samples.push_back(ms);
+    } else {
+        samples[head] = ms;
+    }
+    head = (head + 1) % capacity;
+}
+
+void TimingHistogram::clear() {
+    samples.clear();
+    head = 0;
+}
+
+unsigned int TimingHistogram::count() const {
+    return samples.size();
+}
+
+double TimingHistogram::last() const {
+    if(samples.empty()) {
+        return 0;
+    }
+    return samples[(head + samples.size() - 1) % samples.size()];
+}
+
+double TimingHistogram::mean() const {
+    if(samples.empty()) {
+        return 0;
+    }
+    double total = 0;
+    for(double sample : samples) {
+        total += sample;
+    }
+    return total / samples.size();
+}
+
+double TimingHistogram::max() const {
+    if(samples.empty()) {
+        return 0;
+    }
+    return *max_element(samples.begin(), samples.end());
+}
+
+double TimingHistogram::percentile(double p) const {
+    if(samples.empty()) {
+        return 0;
+    }
+    vector<double> sorted = samples;
+    sort(sorted.begin(), sorted.end());
+    unsigned int i = (unsigned int)(p / 100.0 * (sorted.size() - 1) + 0.5);
+    return sorted[min(i, (unsigned int) sorted.size() - 1)];
+}
+
+vector<unsigned int> TimingHistogram::buckets(double width, unsigned int n) const {
+    vector<unsigned int> result(n, 0);
+    if(n == 0 || width <= 0) {
+        return result;
+    }
+    for(double sample : samples) {
+        unsigned int i = (unsigned int)(sample / width);
+        result[min(i, n - 1)]++;
+    }
+    return result;
+}
+
+string TimingHistogram::summary() const {
+    char text[96];
+    snprintf(text, sizeof(text), "%.2f ms (avg %.2f, p95 %.2f, max %.2f)", last(), mean(), percentile(95), max());
+    return text;
+}
+
+CounterHistory::CounterHistory(unsigned int capacity): capacity(capacity) {
+    frames.reserve(capacity);
+}
+
+void CounterHistory::add(const FrameCounters& counters) {
+    if(frames.size() < capacity) {
+        frames.push_back(counters);
+    } else {
+        frames[head] = counters;
+    }
+    head = (head + 1) % capacity;
+}
+
+void CounterHistory::clear() {
+    frames.clear();
+    head = 0;
+}
+
+unsigned int CounterHistory::count() const {
+    return frames.size();
+}
+
+FrameCounters CounterHistory::mean() const {
+    FrameCounters result;
+    if(frames.empty()) {
+        return result;
+    }
+
+    double interpretMs = 0, draws = 0, uniforms = 0, elided = 0, bytesUploaded = 0, allocations = 0;
+    for(const FrameCounters& frame : frames) {
+        interpretMs += frame.interpretMs;
+        draws += frame.draws;
+        uniforms += frame.uniforms;
+        elided += frame.elided;
+        bytesUploaded += frame.bytesUploaded;
+        allocations += frame.allocations;
+    }
+
+    unsigned int n = frames.size();
+    result.interpretMs = interpretMs / n;
+    result.draws = draws / n + 0.5;
+    result.uniforms = uniforms / n + 0.5;
+    result.elided = elided / n + 0.5;
+    result.bytesUploaded = bytesUploaded / n + 0.5;
+    result.allocations = allocations / n + 0.5;
+    return result;
+}
+
+FrameCounters CounterHistory::peak() const {
+    FrameCounters result;
+    for(const FrameCounters& frame : frames) {
+        result.interpretMs = std::max(result.interpretMs, frame.interpretMs);
+        result.draws = std::max(result.draws, frame.draws);
+        result.uniforms = std::max(result.uniforms, frame.uniforms);
+        result.elided = std::max(result.elided, frame.elided);
+        result.bytesUploaded = std::max(result.bytesUploaded, frame.bytesUploaded);
+        result.allocations = std::max(result.allocations, frame.allocations);
+    }
+    return result;
+}
+
+vector<string> CounterHistory::lines() const {
+    FrameCounters avg = mean();
+    FrameCounters top = peak();
+
+    char text[6][96];
+    snprintf(text[0], sizeof(text[0]), "interpret  %8.2f ms   max %8.2f", avg.interpretMs, top.interpretMs);
+    snprintf(text[1], sizeof(text[1]), "draws      %8u      max %8u", avg.draws, top.draws);
+    snprintf(text[2], sizeof(text[2]), "uniforms   %8u      max %8u", avg.uniforms, top.uniforms);
+    snprintf(text[3], sizeof(text[3]), "uploaded   %8.1f KB   max %8.1f", avg.bytesUploaded / 1024.0, top.bytesUploaded / 1024.0);
+    snprintf(text[4], sizeof(text[4]), "elided     %8u      max %8u", avg.elided, top.elided);
+    snprintf(text[5], sizeof(text[5]), "allocs     %8llu      max %8llu", avg.allocations, top.allocations);
+
+    vector<string> result;
+    result.push_back("last " + to_string(frames.size()) + " frames");
+    for(unsigned int i = 0; i < 6; i++) {
+        result.push_back(text[i]);
+    }
+    return result;
+}
+
+}
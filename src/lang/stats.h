@@ -0,0 +1,67 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <string>
+#include <vector>
+
+using namespace std;
+
+namespace Wyatt {
+
+// What the interpreter did during a single frame
+struct FrameCounters {
+    double interpretMs = 0;
+    unsigned int draws = 0;
+    unsigned int uniforms = 0;
+    // Redundant GL state changes the interpreter skipped
+    unsigned int elided = 0;
+    unsigned long long bytesUploaded = 0;
+    unsigned long long allocations = 0;
+};
+
+// The counters of the last few frames, shared by the GL widget's overlay and the headless runner
+class CounterHistory {
+    public:
+        CounterHistory(unsigned int capacity = 60);
+
+        void add(const FrameCounters&);
+        void clear();
+
+        unsigned int count() const;
+        FrameCounters mean() const;
+        FrameCounters peak() const;
+        vector<string> lines() const;
+
+    private:
+        vector<FrameCounters> frames;
+        unsigned int capacity;
+        unsigned int head = 0;
+};
+
+// Rolling window over the last few hundred samples of a timing, in milliseconds
+class TimingHistogram {
+    public:
+        TimingHistogram(unsigned int capacity = 240);
+
+        void add(double ms);
+        void clear();
+
+        unsigned int count() const;
+        double last() const;
+        double mean() const;
+        double max() const;
+        double percentile(double p) const;
+
+        // Number of samples falling in each of n buckets of the given width; the last bucket catches the overflow
+        vector<unsigned int> buckets(double width, unsigned int n) const;
+        string summary() const;
+
+    private:
+        vector<double> samples;
+        unsigned int capacity;
+        unsigned int head = 0;
+};
+
+}
+
+#endif // STATS_H
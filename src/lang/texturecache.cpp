@@ -0,0 +1,66 @@
+#include "texturecache.h"
+
+namespace Wyatt {
+
+TextureCache::Entry TextureCache::find(const string& path, long long mtime) {
+    auto it = textures.find(make_pair(path, mtime));
+    if(it == textures.end()) {
+        missCount++;
+        return nullptr;
+    }
+    hitCount++;
+    it->second->lastUse = ++clock;
+    return it->second;
+}
+
+TextureCache::Entry TextureCache::insert(const string& path, long long mtime, GLuint handle, int width, int height, int channels,
+                                         unsigned long long bytes, shared_ptr<TextureState> state) {
+    Entry& entry = textures[make_pair(path, mtime)];
+    if(entry != nullptr) {
+        entry->lastUse = ++clock;
+        return entry;
+    }
+
+    entry = make_shared<CachedTexture>();
+    entry->handle = handle;
+    entry->width = width;
+    entry->height = height;
+    entry->channels = channels;
+    entry->bytes = bytes;
+    entry->state = state;
+    entry->lastUse = ++clock;
+    totalBytes += entry->bytes;
+    return entry;
+}
+
+vector<GLuint> TextureCache::evict() {
+    vector<GLuint> unused;
+    while(totalBytes > budget) {
+        auto oldest = textures.end();
+        for(auto it = textures.begin(); it != textures.end(); ++it) {
+            // The cache's own reference is the only one left
+            if(it->second.use_count() == 1 && (oldest == textures.end() || it->second->lastUse < oldest->second->lastUse)) {
+                oldest = it;
+            }
+        }
+        if(oldest == textures.end()) {
+            break;
+        }
+        unused.push_back(oldest->second->handle);
+        totalBytes -= oldest->second->bytes;
+        textures.erase(oldest);
+    }
+    return unused;
+}
+
+vector<GLuint> TextureCache::clear() {
+    vector<GLuint> all;
+    for(auto it = textures.begin(); it != textures.end(); ++it) {
+        all.push_back(it->second->handle);
+    }
+    textures.clear();
+    totalBytes = 0;
+    return all;
+}
+
+}
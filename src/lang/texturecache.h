@@ -0,0 +1,61 @@
+#ifndef TEXTURECACHE_H
+#define TEXTURECACHE_H
+
+#include <map>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+#include "nodes.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// A GL texture uploaded from an image file. Every texture2D showing it holds a reference
+struct CachedTexture {
+    GLuint handle = 0;
+    int width = 0, height = 0, channels = 0;
+    unsigned long long bytes = 0;
+    unsigned long long lastUse = 0;
+    shared_ptr<TextureState> state;
+};
+
+// Image files already decoded and uploaded, kept across reloads and keyed by path and modification
+// time, so re-running a script neither decodes nor uploads an unchanged image again. Entries no
+// texture refers to stay until the textures kept exceed the budget, least recently used going first
+class TextureCache {
+    public:
+        typedef shared_ptr<CachedTexture> Entry;
+
+        Entry find(const string& path, long long mtime);
+        // Takes over handle; returns the entry already cached for the file instead if there is one
+        Entry insert(const string& path, long long mtime, GLuint handle, int width, int height, int channels,
+                     unsigned long long bytes, shared_ptr<TextureState> state);
+        // Forgets unreferenced entries until the rest fit in the budget and hands back their
+        // handles so they can be deleted
+        vector<GLuint> evict();
+        // Hands back every handle, e.g. when the GL context goes away
+        vector<GLuint> clear();
+
+        // Texture memory evict() tries to stay under; textures in use are kept regardless
+        unsigned long long budget = 256ULL * 1024 * 1024;
+
+        unsigned long long bytes() const { return totalBytes; }
+        unsigned int size() const { return textures.size(); }
+        unsigned int hits() const { return hitCount; }
+        unsigned int misses() const { return missCount; }
+
+    private:
+        map<pair<string, long long>, Entry> textures;
+        unsigned long long totalBytes = 0;
+        unsigned long long clock = 0;
+        unsigned int hitCount = 0;
+        unsigned int missCount = 0;
+};
+
+}
+
+#endif // TEXTURECACHE_H
@@ -0,0 +1,245 @@
+#include "texturecontainer.h"
+
+#include <algorithm>
+#include <cctype>
+#include <cstring>
+
+namespace Wyatt {
+
+static const unsigned char KTX_IDENTIFIER[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+
+// DXGI_FORMAT values a DDS file's DX10 header can name
+#define DXGI_FORMAT_BC1_UNORM 71
+#define DXGI_FORMAT_BC1_UNORM_SRGB 72
+#define DXGI_FORMAT_BC3_UNORM 77
+#define DXGI_FORMAT_BC3_UNORM_SRGB 78
+#define DXGI_FORMAT_BC7_UNORM 98
+#define DXGI_FORMAT_BC7_UNORM_SRGB 99
+
+#define DDSD_MIPMAPCOUNT 0x20000
+#define DDSCAPS2_CUBEMAP 0x200
+#define DDPF_FOURCC 0x4
+
+static unsigned int read_u32(const unsigned char* data, bool swap) {
+    unsigned int value;
+    memcpy(&value, data, 4);
+    if(swap) {
+        value = (value >> 24) | ((value >> 8) & 0xFF00) | ((value << 8) & 0xFF0000) | (value << 24);
+    }
+    return value;
+}
+
+static unsigned int fourcc(const char* code) {
+    return (unsigned int) code[0] | ((unsigned int) code[1] << 8) | ((unsigned int) code[2] << 16) | ((unsigned int) code[3] << 24);
+}
+
+bool is_container(const string& path) {
+    size_t dot = path.find_last_of('.');
+    if(dot == string::npos) {
+        return false;
+    }
+    string extension = path.substr(dot + 1);
+    transform(extension.begin(), extension.end(), extension.begin(), ::tolower);
+    return extension == "ktx" || extension == "dds";
+}
+
+unsigned int block_bytes(GLenum format) {
+    switch(format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGB8_ETC2:
+        case GL_COMPRESSED_SRGB8_ETC2:
+        case GL_COMPRESSED_RGB8_PUNCHTHROUGH_ALPHA1_ETC2:
+            return 8;
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+        case GL_COMPRESSED_RGBA8_ETC2_EAC:
+        case GL_COMPRESSED_SRGB8_ALPHA8_ETC2_EAC:
+            return 16;
+        default:
+            return 0;
+    }
+}
+
+static size_t level_size(GLenum format, int width, int height) {
+    return (size_t) ((max(width, 1) + 3) / 4) * ((max(height, 1) + 3) / 4) * block_bytes(format);
+}
+
+// Mip levels are halved with shifts, so the size has to fit an int and the levels must run out
+// by 1x1; anything else is a corrupt file rather than something to upload
+static bool check_size(unsigned int width, unsigned int height, unsigned int mipmaps, unsigned int maxSize, const char* kind, string& error) {
+    if(width > maxSize || height > maxSize) {
+        error = string(kind) + " texture is " + to_string(width) + "x" + to_string(height) + ", larger than the " + to_string(maxSize) + " GL allows";
+        return false;
+    }
+    unsigned int fullChain = 1;
+    for(unsigned int largest = max(width, height); largest > 1; largest >>= 1) {
+        fullChain++;
+    }
+    if(mipmaps > fullChain) {
+        error = string(kind) + " file has " + to_string(mipmaps) + " mip levels, but a " + to_string(width) + "x" + to_string(height) + " image has at most " + to_string(fullChain);
+        return false;
+    }
+    return true;
+}
+
+// Header fields, then key/value data, then each level as its size followed by its blocks
+static bool parse_ktx(const unsigned char* data, size_t size, unsigned int maxSize, TextureContainer& container, string& error) {
+    if(size < 64) {
+        error = "truncated KTX header";
+        return false;
+    }
+
+    unsigned int endianness;
+    memcpy(&endianness, data + 12, 4);
+    bool swap = endianness == 0x01020304;
+    if(!swap && endianness != 0x04030201) {
+        error = "bad KTX endianness";
+        return false;
+    }
+
+    unsigned int glType = read_u32(data + 16, swap);
+    unsigned int internalFormat = read_u32(data + 28, swap);
+    unsigned int width = read_u32(data + 36, swap);
+    unsigned int height = read_u32(data + 40, swap);
+    unsigned int depth = read_u32(data + 44, swap);
+    unsigned int elements = read_u32(data + 48, swap);
+    unsigned int faces = read_u32(data + 52, swap);
+    unsigned int mipmaps = read_u32(data + 56, swap);
+    unsigned int keyValueBytes = read_u32(data + 60, swap);
+
+    if(glType != 0 || block_bytes(internalFormat) == 0) {
+        error = "only BC1, BC3, BC7 and ETC2 compressed KTX files are supported";
+        return false;
+    }
+    if(depth > 1 || elements > 0 || faces != 1 || width == 0 || height == 0) {
+        error = "only 2D KTX textures are supported";
+        return false;
+    }
+    if(!check_size(width, height, mipmaps, maxSize, "KTX", error)) {
+        return false;
+    }
+
+    container.format = internalFormat;
+    container.width = width;
+    container.height = height;
+    size_t offset = 64 + (size_t) keyValueBytes;
+    for(unsigned int i = 0; i < max(mipmaps, 1u); i++) {
+        if(offset + 4 > size) {
+            error = "truncated KTX mip level " + to_string(i);
+            return false;
+        }
+        size_t imageSize = read_u32(data + offset, swap);
+        offset += 4;
+
+        TextureLevel level;
+        level.width = max(1, (int) (width >> i));
+        level.height = max(1, (int) (height >> i));
+        level.offset = offset;
+        level.size = imageSize;
+        if(imageSize < level_size(internalFormat, level.width, level.height) || offset + imageSize > size) {
+            error = "truncated KTX mip level " + to_string(i);
+            return false;
+        }
+        container.levels.push_back(level);
+        offset += (imageSize + 3) / 4 * 4;
+    }
+    return true;
+}
+
+// "DDS ", a 124 byte header holding the pixel format at 76, then an optional DX10 header
+static bool parse_dds(const unsigned char* data, size_t size, unsigned int maxSize, TextureContainer& container, string& error) {
+    if(size < 128 || read_u32(data + 4, false) != 124) {
+        error = "truncated DDS header";
+        return false;
+    }
+
+    unsigned int flags = read_u32(data + 8, false);
+    unsigned int height = read_u32(data + 12, false);
+    unsigned int width = read_u32(data + 16, false);
+    unsigned int depth = read_u32(data + 24, false);
+    unsigned int mipmaps = (flags & DDSD_MIPMAPCOUNT)? read_u32(data + 28, false) : 1;
+    unsigned int formatFlags = read_u32(data + 80, false);
+    unsigned int code = read_u32(data + 84, false);
+    unsigned int caps2 = read_u32(data + 112, false);
+
+    if((caps2 & DDSCAPS2_CUBEMAP) || depth > 1 || width == 0 || height == 0) {
+        error = "only 2D DDS textures are supported";
+        return false;
+    }
+    if(!check_size(width, height, mipmaps, maxSize, "DDS", error)) {
+        return false;
+    }
+
+    size_t offset = 128;
+    GLenum format = 0;
+    if(formatFlags & DDPF_FOURCC) {
+        if(code == fourcc("DXT1")) {
+            format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT;
+        } else
+        if(code == fourcc("DXT5")) {
+            format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT;
+        } else
+        if(code == fourcc("DX10")) {
+            if(size < 148) {
+                error = "truncated DDS DX10 header";
+                return false;
+            }
+            unsigned int dxgiFormat = read_u32(data + 128, false);
+            unsigned int arraySize = read_u32(data + 140, false);
+            if(arraySize > 1) {
+                error = "only 2D DDS textures are supported";
+                return false;
+            }
+            switch(dxgiFormat) {
+                case DXGI_FORMAT_BC1_UNORM: format = GL_COMPRESSED_RGBA_S3TC_DXT1_EXT; break;
+                case DXGI_FORMAT_BC1_UNORM_SRGB: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT; break;
+                case DXGI_FORMAT_BC3_UNORM: format = GL_COMPRESSED_RGBA_S3TC_DXT5_EXT; break;
+                case DXGI_FORMAT_BC3_UNORM_SRGB: format = GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT; break;
+                case DXGI_FORMAT_BC7_UNORM: format = GL_COMPRESSED_RGBA_BPTC_UNORM; break;
+                case DXGI_FORMAT_BC7_UNORM_SRGB: format = GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM; break;
+                default: break;
+            }
+            offset = 148;
+        }
+    }
+    if(format == 0) {
+        error = "only BC1, BC3 and BC7 DDS files are supported";
+        return false;
+    }
+
+    container.format = format;
+    container.width = width;
+    container.height = height;
+    for(unsigned int i = 0; i < max(mipmaps, 1u); i++) {
+        TextureLevel level;
+        level.width = max(1, (int) (width >> i));
+        level.height = max(1, (int) (height >> i));
+        level.offset = offset;
+        level.size = level_size(format, level.width, level.height);
+        if(offset + level.size > size) {
+            error = "truncated DDS mip level " + to_string(i);
+            return false;
+        }
+        container.levels.push_back(level);
+        offset += level.size;
+    }
+    return true;
+}
+
+bool parse_container(const unsigned char* data, size_t size, unsigned int maxSize, TextureContainer& container, string& error) {
+    container = TextureContainer();
+    if(size >= 12 && memcmp(data, KTX_IDENTIFIER, 12) == 0) {
+        return parse_ktx(data, size, maxSize, container, error);
+    }
+    if(size >= 4 && memcmp(data, "DDS ", 4) == 0) {
+        return parse_dds(data, size, maxSize, container, error);
+    }
+    error = "not a KTX or DDS file";
+    return false;
+}
+
+}
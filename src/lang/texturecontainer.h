@@ -0,0 +1,33 @@
+#ifndef TEXTURECONTAINER_H
+#define TEXTURECONTAINER_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+
+#include "textureformat.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// A pre-compressed 2D image and its mip chain, as stored in a KTX (version 1) or DDS file. Parsing
+// only looks at the bytes, so it needs neither a GL context nor Qt
+struct TextureContainer {
+    GLenum format = 0;
+    int width = 0, height = 0;
+    // Largest first; offsets are into the file's bytes
+    vector<TextureLevel> levels;
+};
+
+// True for the file names parse_container() should be given instead of stb_image
+bool is_container(const string& path);
+// Fills container from a whole KTX or DDS file, or returns false with the reason in error. Images
+// wider or taller than maxSize, e.g. GL_MAX_TEXTURE_SIZE, are rejected
+bool parse_container(const unsigned char* data, size_t size, unsigned int maxSize, TextureContainer& container, string& error);
+// Bytes in each 4x4 block of a format parse_container() accepts, or 0
+unsigned int block_bytes(GLenum format);
+
+}
+
+#endif // TEXTURECONTAINER_H
@@ -0,0 +1,209 @@
+#include "textureloader.h"
+
+#include <fstream>
+
+#include <QOpenGLContext>
+#include <stb_image.h>
+
+#include "helper.h"
+#include "texturecontainer.h"
+#include "threadpool.h"
+#include "trace.h"
+
+namespace Wyatt {
+
+atomic<unsigned long long> TextureLoader::pixelBytes{0};
+
+TextureLoader::TextureLoader(LogWindow* logger, TextureCache* cache, GLRegistry* registry): logger(logger), cache(cache), registry(registry) {}
+
+void TextureLoader::open(QOpenGLFunctions* gl) {
+    this->gl = gl;
+    gl->glGetIntegerv(GL_MAX_TEXTURE_SIZE, &maxSize);
+}
+
+void TextureLoader::load(Texture::ptr tex, const string& path, Node::ptr origin) {
+    tex->source = path;
+    tex->mtime = file_mtime(path);
+    TextureCache::Entry entry = cache->find(path, tex->mtime);
+    if(entry != nullptr) {
+        tex->loading = false;
+        tex->cached = entry;
+        tex->handle = entry->handle;
+        tex->width = entry->width;
+        tex->height = entry->height;
+        tex->channels = entry->channels;
+        tex->state = entry->state;
+        return;
+    }
+
+    Job job;
+    job.path = path;
+    job.origin = origin;
+    unsigned int maxSize = this->maxSize;
+    job.image = ThreadPool::shared().submit([=]() {
+        TRACE_SCOPE("load", "decode " + path);
+        return decode(path, maxSize);
+    });
+
+    tex->loading = true;
+    jobs[tex] = move(job);
+}
+
+bool TextureLoader::resolve(Texture::ptr tex, bool wait) {
+    auto found = jobs.find(tex);
+    if(found == jobs.end()) {
+        tex->loading = false;
+        return true;
+    }
+
+    Job& job = found->second;
+    if(!wait && job.image.wait_for(chrono::seconds(0)) != future_status::ready) {
+        return false;
+    }
+    finish(tex, job);
+    jobs.erase(found);
+    return true;
+}
+
+void TextureLoader::wait_all() {
+    TRACE_SCOPE("load", "wait_textures");
+    for(auto it = jobs.begin(); it != jobs.end(); ++it) {
+        finish(it->first, it->second);
+    }
+    jobs.clear();
+}
+
+void TextureLoader::finish(Texture::ptr tex, Job& job) {
+    Image image = job.image.get();
+    tex->loading = false;
+    if(image.pixels == nullptr) {
+        string message = "Cannot load " + job.path + ": " + image.error;
+        if(job.origin != nullptr) {
+            logger->log(job.origin, "ERROR", message);
+        } else {
+            logger->log("ERROR: " + message);
+        }
+        return;
+    }
+    unsigned long long bytes = image.size;
+    pixelBytes += bytes;
+    tex->image = shared_ptr<unsigned char>(image.pixels, [image, bytes](unsigned char*) mutable {
+        free_image(image);
+        pixelBytes -= bytes;
+    });
+    tex->width = image.width;
+    tex->height = image.height;
+    tex->channels = image.channels;
+    tex->format = image.format;
+    tex->levels = image.levels;
+}
+
+// Runs on the thread pool. KTX and DDS files are kept as they are, since their blocks are uploaded
+// without decompressing them; anything else is decoded to RGBA by stb_image
+TextureLoader::Image TextureLoader::decode(const string& path, unsigned int maxSize) {
+    Image image;
+    if(!is_container(path)) {
+        image.pixels = stbi_load(path.c_str(), &(image.width), &(image.height), &(image.channels), 4);
+        if(image.pixels == nullptr) {
+            image.error = stbi_failure_reason();
+        } else
+        if((unsigned int) image.width > maxSize || (unsigned int) image.height > maxSize) {
+            image.error = "image is " + to_string(image.width) + "x" + to_string(image.height) + ", larger than the " + to_string(maxSize) + " GL allows";
+            free_image(image);
+        }
+        image.size = (size_t) image.width * image.height * 4;
+        return image;
+    }
+
+    ifstream file(path, ios::binary | ios::ate);
+    if(!file) {
+        image.error = "can't open file";
+        return image;
+    }
+    image.size = file.tellg();
+    image.pixels = new unsigned char[image.size];
+    image.container = true;
+    file.seekg(0);
+    file.read((char*) image.pixels, image.size);
+
+    TextureContainer container;
+    if(!file || !parse_container(image.pixels, image.size, maxSize, container, image.error)) {
+        if(image.error == "") {
+            image.error = "can't read file";
+        }
+        free_image(image);
+        return image;
+    }
+    image.width = container.width;
+    image.height = container.height;
+    image.channels = 4;
+    image.format = container.format;
+    image.levels = container.levels;
+    return image;
+}
+
+void TextureLoader::free_image(Image& image) {
+    if(image.container) {
+        delete[] image.pixels;
+    } else {
+        stbi_image_free(image.pixels);
+    }
+    image.pixels = nullptr;
+}
+
+bool TextureLoader::supports(GLenum format) const {
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context == nullptr) {
+        return false;
+    }
+    QSurfaceFormat surface = context->format();
+    switch(format) {
+        case GL_COMPRESSED_RGB_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_RGBA_S3TC_DXT5_EXT:
+            return context->hasExtension("GL_EXT_texture_compression_s3tc");
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT1_EXT:
+        case GL_COMPRESSED_SRGB_ALPHA_S3TC_DXT5_EXT:
+            return context->hasExtension("GL_EXT_texture_compression_s3tc") &&
+                   (context->hasExtension("GL_EXT_texture_sRGB") || context->hasExtension("GL_EXT_texture_compression_s3tc_srgb"));
+        case GL_COMPRESSED_RGBA_BPTC_UNORM:
+        case GL_COMPRESSED_SRGB_ALPHA_BPTC_UNORM:
+            return context->hasExtension("GL_ARB_texture_compression_bptc") || context->hasExtension("GL_EXT_texture_compression_bptc") ||
+                   (!context->isOpenGLES() && surface.version() >= qMakePair(4, 2));
+        default:
+            // ETC2 is core in ES 3.0 and GL 4.3
+            return (context->isOpenGLES() && surface.majorVersion() >= 3) || context->hasExtension("GL_ARB_ES3_compatibility") ||
+                   (!context->isOpenGLES() && surface.version() >= qMakePair(4, 3));
+    }
+}
+
+GLuint TextureLoader::placeholder() {
+    if(placeholderHandle == 0) {
+        unsigned char pixel[4] = { 128, 128, 128, 255 };
+        bool reused;
+        placeholderHandle = registry->create_texture(1, 1, GL_RGBA, reused);
+        gl->glBindTexture(GL_TEXTURE_2D, placeholderHandle);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
+        gl->glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
+        gl->glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, 1, 1, 0, GL_RGBA, GL_UNSIGNED_BYTE, pixel);
+    }
+    return placeholderHandle;
+}
+
+void TextureLoader::clear() {
+    for(auto it = jobs.begin(); it != jobs.end(); ++it) {
+        Image image = it->second.image.get();
+        free_image(image);
+        it->first->loading = false;
+    }
+    jobs.clear();
+}
+
+void TextureLoader::release() {
+    if(placeholderHandle != 0) {
+        registry->release(OBJECT_TEXTURE, placeholderHandle);
+        placeholderHandle = 0;
+    }
+}
+
+}
@@ -0,0 +1,88 @@
+#ifndef TEXTURELOADER_H
+#define TEXTURELOADER_H
+
+#include <atomic>
+#include <future>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+#include "nodes.h"
+#include "logwindow.h"
+#include "texturecache.h"
+#include "glregistry.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// Decodes the images assigned to texture2D variables on the thread pool, unless the cache already
+// has the file uploaded. A texture stays `loading`, with no pixels, until resolve() takes the
+// decoded image; until then the interpreter binds placeholder() in its place. Only resolve() and
+// the GL calls run on the GL thread
+class TextureLoader {
+    public:
+        TextureLoader(LogWindow*, TextureCache*, GLRegistry*);
+
+        void open(QOpenGLFunctions* gl);
+
+        // Starts decoding path into tex; origin is what errors are reported against
+        void load(Texture::ptr tex, const string& path, Node::ptr origin);
+        // Moves the decoded pixels into tex once they're ready, or waits for them with wait.
+        // Returns false while the decode is still running
+        bool resolve(Texture::ptr tex, bool wait);
+        // Waits for every decode started so far
+        void wait_all();
+        unsigned int pending() const { return jobs.size(); }
+        // Decoded pixels not freed yet, across every loader
+        static unsigned long long pixel_bytes() { return pixelBytes; }
+        // Whether the context can sample a compressed format
+        bool supports(GLenum format) const;
+        // A 1x1 texture to sample while the real one is loading or failed to load
+        GLuint placeholder();
+        // Drops the textures still loading, e.g. when the program restarts
+        void clear();
+        // Deletes the placeholder, e.g. when the GL context goes away
+        void release();
+
+    private:
+        struct Image {
+            unsigned char* pixels = nullptr;
+            int width = 0, height = 0, channels = 0;
+            // Set for KTX and DDS files, whose bytes pixels holds as they are
+            GLenum format = 0;
+            vector<TextureLevel> levels;
+            size_t size = 0;
+            // pixels came from new[] rather than stb_image
+            bool container = false;
+            string error;
+        };
+
+        struct Job {
+            future<Image> image;
+            string path;
+            Node::ptr origin;
+        };
+
+        LogWindow* logger;
+        TextureCache* cache;
+        GLRegistry* registry;
+        QOpenGLFunctions* gl = nullptr;
+        GLuint placeholderHandle = 0;
+        // GL_MAX_TEXTURE_SIZE; larger images are rejected when they're decoded
+        GLint maxSize = 2048;
+
+        map<Texture::ptr, Job> jobs;
+        // Textures free their pixels themselves, possibly after the loader is gone
+        static atomic<unsigned long long> pixelBytes;
+
+        void finish(Texture::ptr tex, Job& job);
+        static Image decode(const string& path, unsigned int maxSize);
+        static void free_image(Image& image);
+};
+
+}
+
+#endif // TEXTURELOADER_H
@@ -0,0 +1,46 @@
+#include "threadpool.h"
+
+#include <algorithm>
+
+namespace Wyatt {
+
+ThreadPool::ThreadPool(unsigned int threads) {
+    for(unsigned int i = 0; i < threads; i++) {
+        workers.push_back(thread(&ThreadPool::work, this));
+    }
+}
+
+ThreadPool::~ThreadPool() {
+    {
+        lock_guard<mutex> guard(lock);
+        stopping = true;
+    }
+    wakeup.notify_all();
+    for(thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// One thread is left for the GL thread, but there is always at least one worker
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(max(2u, thread::hardware_concurrency()) - 1);
+    return pool;
+}
+
+void ThreadPool::work() {
+    while(true) {
+        function<void()> job;
+        {
+            unique_lock<mutex> guard(lock);
+            wakeup.wait(guard, [this]() { return stopping || !jobs.empty(); });
+            if(stopping && jobs.empty()) {
+                return;
+            }
+            job = move(jobs.front());
+            jobs.pop();
+        }
+        job();
+    }
+}
+
+}
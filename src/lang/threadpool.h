@@ -0,0 +1,51 @@
+#ifndef THREADPOOL_H
+#define THREADPOOL_H
+
+#include <condition_variable>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+namespace Wyatt {
+
+// Fixed set of worker threads shared by everything that needs work done off the GL thread
+class ThreadPool {
+    public:
+        ThreadPool(unsigned int threads);
+        ~ThreadPool();
+
+        static ThreadPool& shared();
+
+        template<typename F>
+        auto submit(F task) -> future<decltype(task())> {
+            auto job = make_shared<packaged_task<decltype(task())()>>(task);
+            future<decltype(task())> result = job->get_future();
+            {
+                lock_guard<mutex> guard(lock);
+                jobs.push([job]() { (*job)(); });
+            }
+            wakeup.notify_one();
+            return result;
+        }
+
+        unsigned int size() const { return workers.size(); }
+
+    private:
+        vector<thread> workers;
+        queue<function<void()>> jobs;
+        mutex lock;
+        condition_variable wakeup;
+        bool stopping = false;
+
+        void work();
+};
+
+}
+
+#endif // THREADPOOL_H
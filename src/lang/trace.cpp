@@ -0,0 +1,178 @@
+#include "trace.h"
+
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <mutex>
+#include <vector>
+
+// Events kept per thread; once a thread has recorded this many, each new event replaces its oldest
+#define TRACE_CAPACITY 32768
+// The ring is allocated this many events at a time, as the thread first gets to them
+#define TRACE_CHUNK 1024
+// Longer names are cut short, so recording an event only allocates when it starts a new chunk
+#define TRACE_NAME 64
+
+namespace Wyatt {
+
+namespace {
+
+struct TraceEvent {
+    const char* category;
+    char name[TRACE_NAME];
+    long long start, end;
+};
+
+// A ring of the thread's latest events. Only the thread itself records into it, without locking:
+// it bumps started, fills in the slot and then publishes it by bumping written. Readers copy the
+// published slots and then drop whichever ones the thread has started overwriting meanwhile
+struct ThreadBuffer {
+    unsigned int tid;
+    atomic<TraceEvent*> chunks[TRACE_CAPACITY / TRACE_CHUNK];
+    // How many events the thread has begun, and finished, recording
+    atomic<unsigned long long> started, written;
+    // Events before this one were dropped by clear()
+    atomic<unsigned long long> first;
+
+    ThreadBuffer(unsigned int tid): tid(tid), started(0), written(0), first(0) {
+        for(auto& chunk : chunks) {
+            chunk.store(nullptr, memory_order_relaxed);
+        }
+    }
+
+    void append(const char* category, const char* name, long long start, long long end) {
+        unsigned long long index = written.load(memory_order_relaxed);
+        size_t slot = index % TRACE_CAPACITY;
+        TraceEvent* chunk = chunks[slot / TRACE_CHUNK].load(memory_order_relaxed);
+        if(chunk == nullptr) {
+            chunk = new TraceEvent[TRACE_CHUNK];
+            chunks[slot / TRACE_CHUNK].store(chunk, memory_order_release);
+        }
+
+        started.store(index + 1, memory_order_relaxed);
+        atomic_thread_fence(memory_order_release);
+        TraceEvent& event = chunk[slot % TRACE_CHUNK];
+        event.category = category;
+        strncpy(event.name, name, TRACE_NAME - 1);
+        event.name[TRACE_NAME - 1] = '\0';
+        event.start = start;
+        event.end = end;
+        written.store(index + 1, memory_order_release);
+    }
+
+    void clear() {
+        first.store(written.load(memory_order_acquire), memory_order_release);
+    }
+
+    // Appends the events still in the ring to events, oldest first
+    void read(vector<TraceEvent>& events) {
+        unsigned long long end = written.load(memory_order_acquire);
+        unsigned long long begin = max(first.load(memory_order_acquire), end > TRACE_CAPACITY? end - TRACE_CAPACITY : 0ULL);
+        // clear() may have run since written was read
+        begin = min(begin, end);
+        size_t copied = events.size();
+        for(unsigned long long i = begin; i < end; i++) {
+            size_t slot = i % TRACE_CAPACITY;
+            events.push_back(chunks[slot / TRACE_CHUNK].load(memory_order_acquire)[slot % TRACE_CHUNK]);
+        }
+
+        // Events before `now - TRACE_CAPACITY` may have had their slots reused while being copied
+        atomic_thread_fence(memory_order_acquire);
+        unsigned long long now = started.load(memory_order_relaxed);
+        if(now > begin + TRACE_CAPACITY) {
+            size_t overwritten = min<unsigned long long>(now - TRACE_CAPACITY - begin, end - begin);
+            events.erase(events.begin() + copied, events.begin() + copied + overwritten);
+        }
+    }
+};
+
+mutex registryLock;
+vector<ThreadBuffer*> registry;
+const chrono::steady_clock::time_point epoch = chrono::steady_clock::now();
+
+ThreadBuffer* local_buffer() {
+    thread_local ThreadBuffer* buffer = nullptr;
+    if(buffer == nullptr) {
+        lock_guard<mutex> guard(registryLock);
+        buffer = new ThreadBuffer(registry.size() + 1);
+        registry.push_back(buffer);
+    }
+    return buffer;
+}
+
+string escape(const string& text) {
+    string result;
+    for(char c : text) {
+        if(c == '"' || c == '\\') {
+            result += '\\';
+            result += c;
+        } else if((unsigned char) c < 0x20) {
+            char code[8];
+            snprintf(code, sizeof(code), "\\u%04x", c);
+            result += code;
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+}
+
+atomic<bool> Trace::active(false);
+
+void Trace::set_enabled(bool enabled) {
+    active.store(enabled, memory_order_relaxed);
+}
+
+long long Trace::now() {
+    return chrono::duration_cast<chrono::nanoseconds>(chrono::steady_clock::now() - epoch).count();
+}
+
+void Trace::complete(const char* category, const char* name, long long start, long long end) {
+    local_buffer()->append(category, name, start, end);
+}
+
+void Trace::complete(const char* category, const string& name, long long start, long long end) {
+    local_buffer()->append(category, name.c_str(), start, end);
+}
+
+void Trace::clear() {
+    lock_guard<mutex> guard(registryLock);
+    for(ThreadBuffer* buffer : registry) {
+        buffer->clear();
+    }
+}
+
+bool Trace::write(const string& path) {
+    ofstream out(path);
+    if(!out.is_open()) {
+        return false;
+    }
+
+    out << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    out << "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"wyatt\"}}";
+
+    char times[64];
+    vector<TraceEvent> events;
+    lock_guard<mutex> guard(registryLock);
+    for(ThreadBuffer* buffer : registry) {
+        out << ",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" << buffer->tid
+            << ",\"args\":{\"name\":\"thread " << buffer->tid << "\"}}";
+
+        events.clear();
+        buffer->read(events);
+        for(const TraceEvent& event : events) {
+            snprintf(times, sizeof(times), "\"ts\":%.3f,\"dur\":%.3f", event.start / 1000.0, (event.end - event.start) / 1000.0);
+            out << ",\n{\"name\":\"" << escape(event.name) << "\",\"cat\":\"" << event.category
+                << "\",\"ph\":\"X\",\"pid\":1,\"tid\":" << buffer->tid << "," << times << "}";
+        }
+    }
+
+    out << "\n]}\n";
+    return true;
+}
+
+}
@@ -0,0 +1,69 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <atomic>
+#include <cstddef>
+#include <string>
+
+using namespace std;
+
+namespace Wyatt {
+
+// Records spans as Chrome/Perfetto trace events. Each thread appends to a ring of its own, holding
+// its latest TRACE_CAPACITY events, without taking a lock, so recording can be left on; the ring is
+// registered (once, under a mutex) the first time a thread records anything
+class Trace {
+    public:
+        static void set_enabled(bool);
+        static bool enabled() { return active.load(memory_order_relaxed); }
+
+        // Drops everything recorded so far; the rings are kept for the events to come
+        static void clear();
+        static bool write(const string& path);
+
+        // Nanoseconds on the trace's clock
+        static long long now();
+        static void complete(const char* category, const char* name, long long start, long long end);
+        static void complete(const char* category, const string& name, long long start, long long end);
+
+    private:
+        static atomic<bool> active;
+};
+
+// Records the enclosing block as one span. A string literal name is kept as it is; any other name
+// is copied, and only while tracing is on
+class TraceScope {
+    public:
+        template<size_t N>
+        TraceScope(const char* category, const char (&name)[N]): category(category), literal(name) {
+            start = Trace::enabled() ? Trace::now() : -1;
+        }
+        TraceScope(const char* category, const string& name): category(category), literal(nullptr) {
+            start = Trace::enabled() ? Trace::now() : -1;
+            if(start >= 0) {
+                this->name = name;
+            }
+        }
+        ~TraceScope() {
+            if(start < 0) return;
+            if(literal == nullptr) {
+                Trace::complete(category, name, start, Trace::now());
+            } else {
+                Trace::complete(category, literal, start, Trace::now());
+            }
+        }
+
+    private:
+        const char* category;
+        const char* literal;
+        string name;
+        long long start;
+};
+
+}
+
+#define TRACE_CONCAT_(a, b) a##b
+#define TRACE_CONCAT(a, b) TRACE_CONCAT_(a, b)
+#define TRACE_SCOPE(category, name) Wyatt::TraceScope TRACE_CONCAT(trace_scope_, __LINE__)(category, name)
+
+#endif // TRACE_H
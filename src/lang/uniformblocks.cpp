@@ -0,0 +1,271 @@
+#include "uniformblocks.h"
+
+#include <algorithm>
+#include <cstring>
+
+#include <QOpenGLContext>
+
+#ifndef GL_UNIFORM_BUFFER
+#define GL_UNIFORM_BUFFER 0x8A11
+#endif
+#ifndef GL_INVALID_INDEX
+#define GL_INVALID_INDEX 0xFFFFFFFFu
+#endif
+
+namespace Wyatt {
+
+UniformBlocks::UniformBlocks(LogWindow* logger, GLRegistry* registry): logger(logger), registry(registry) {}
+
+void UniformBlocks::open(QOpenGLFunctions* gl) {
+    this->gl = gl;
+    QOpenGLContext* context = QOpenGLContext::currentContext();
+    if(context == nullptr) {
+        return;
+    }
+
+    QSurfaceFormat format = context->format();
+    bool supported = context->hasExtension("GL_ARB_uniform_buffer_object") ||
+                     (context->isOpenGLES() && format.majorVersion() >= 3) ||
+                     (!context->isOpenGLES() && format.version() >= qMakePair(3, 1));
+    if(supported) {
+        bindBufferBase = (BindBufferBase) context->getProcAddress("glBindBufferBase");
+        getUniformBlockIndex = (GetUniformBlockIndex) context->getProcAddress("glGetUniformBlockIndex");
+        uniformBlockBinding = (UniformBlockBinding) context->getProcAddress("glUniformBlockBinding");
+        if(getUniformBlockIndex == nullptr || uniformBlockBinding == nullptr) {
+            bindBufferBase = nullptr;
+        }
+    }
+}
+
+void UniformBlocks::update(const map<string, ProgramLayout::ptr>& layouts) {
+    for(auto it = blocks.begin(); it != blocks.end();) {
+        auto layout = layouts.find(it->first);
+        if(layout == layouts.end() || !layout->second->uniform || layout->second->digest != it->second.layout->digest) {
+            registry->release(OBJECT_BUFFER, it->second.handle);
+            it = blocks.erase(it);
+        } else {
+            ++it;
+        }
+    }
+
+    for(auto it = layouts.begin(); it != layouts.end(); ++it) {
+        if(!it->second->uniform || blocks.find(it->first) != blocks.end()) {
+            continue;
+        }
+
+        Block block;
+        block.layout = it->second;
+        if(!layout_block(block)) {
+            continue;
+        }
+
+        // Lowest binding point no other block has
+        bool taken = true;
+        while(taken) {
+            taken = false;
+            for(auto jt = blocks.begin(); jt != blocks.end(); ++jt) {
+                taken = taken || jt->second.binding == block.binding;
+            }
+            if(taken) {
+                block.binding++;
+            }
+        }
+
+        if(is_open()) {
+            block.handle = registry->create(OBJECT_BUFFER);
+            gl->glBindBuffer(GL_UNIFORM_BUFFER, block.handle);
+            gl->glBufferData(GL_UNIFORM_BUFFER, block.data.size(), &(block.data[0]), GL_DYNAMIC_DRAW);
+            bindBufferBase(GL_UNIFORM_BUFFER, block.binding, block.handle);
+            gl->glBindBuffer(GL_UNIFORM_BUFFER, 0);
+        } else {
+            logger->log(it->second, "ERROR", "Uniform block " + it->first + " needs OpenGL 3.1 or GL_ARB_uniform_buffer_object");
+        }
+        blocks[it->first] = block;
+    }
+}
+
+// std140: scalars align to 4 bytes, vec2 to 8, vec3 and vec4 to 16, and every matrix column is a
+// vec4-aligned array element. The block's size rounds up to 16 too
+bool UniformBlocks::layout_block(Block& block) {
+    unsigned int offset = 0;
+    for(auto it = block.layout->attribs->begin(); it != block.layout->attribs->end(); ++it) {
+        Decl::ptr attrib = *it;
+        string type = attrib->datatype->name;
+        unsigned int align, size;
+        if(type == "float" || type == "int" || type == "bool") {
+            align = 4; size = 4;
+        } else if(type == "vec2") {
+            align = 8; size = 8;
+        } else if(type == "vec3") {
+            align = 16; size = 12;
+        } else if(type == "vec4") {
+            align = 16; size = 16;
+        } else if(type == "mat2") {
+            align = 16; size = 32;
+        } else if(type == "mat3") {
+            align = 16; size = 48;
+        } else if(type == "mat4") {
+            align = 16; size = 64;
+        } else {
+            logger->log(attrib, "ERROR", "Uniform block " + block.layout->ident->name + " can't hold a " + type);
+            return false;
+        }
+
+        offset = (offset + align - 1) / align * align;
+        Member member;
+        member.type = type;
+        member.offset = offset;
+        block.members[attrib->ident->name] = member;
+        offset += size;
+    }
+
+    block.data.assign(max((offset + 15) / 16 * 16, 16u), 0);
+    return true;
+}
+
+void UniformBlocks::bind(GLuint program) {
+    if(!is_open()) {
+        return;
+    }
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        GLuint index = getUniformBlockIndex(program, it->first.c_str());
+        if(index != GL_INVALID_INDEX) {
+            uniformBlockBinding(program, index, it->second.binding);
+        }
+    }
+}
+
+bool UniformBlocks::assign(Dot::ptr dot, Expr::ptr value) {
+    Block& block = blocks[dot->owner->name];
+    auto found = block.members.find(dot->name);
+    if(found == block.members.end()) {
+        logger->log(dot, "ERROR", "Uniform block " + dot->owner->name + " has no member " + dot->name);
+        return false;
+    }
+    Member member = found->second;
+
+    unsigned char bytes[64];
+    unsigned int size = 0;
+    if(member.type == "int" || member.type == "bool") {
+        GLint i;
+        if(member.type == "int" && value->type == NODE_INT) {
+            i = static_pointer_cast<Int>(value)->value;
+        } else if(member.type == "bool" && value->type == NODE_BOOL) {
+            i = static_pointer_cast<Bool>(value)->value;
+        } else {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: " + member.type + " required for " + dot->name + " of uniform block " + dot->owner->name);
+            return false;
+        }
+        memcpy(bytes, &i, sizeof(i));
+        size = sizeof(i);
+    } else {
+        vector<float> columns;
+        unsigned int stride;
+        if(!pack(member.type, value, columns, stride)) {
+            logger->log(dot, "ERROR", "Uniform upload mismatch: " + member.type + " required for " + dot->name + " of uniform block " + dot->owner->name);
+            return false;
+        }
+
+        // Matrix columns are 16 bytes apart whatever their length
+        memset(bytes, 0, sizeof(bytes));
+        for(unsigned int i = 0; i < columns.size() / stride; i++) {
+            memcpy(bytes + i * 16, &columns[i * stride], stride * sizeof(float));
+            size = i * 16 + stride * sizeof(float);
+        }
+    }
+
+    unsigned char* target = &(block.data[member.offset]);
+    if(memcmp(target, bytes, size) != 0) {
+        memcpy(target, bytes, size);
+        block.dirty = true;
+    }
+    return true;
+}
+
+static bool scalar(Expr::ptr expr, float& result) {
+    if(expr != nullptr && expr->type == NODE_FLOAT) {
+        result = static_pointer_cast<Float>(expr)->value;
+        return true;
+    }
+    if(expr != nullptr && expr->type == NODE_INT) {
+        result = static_pointer_cast<Int>(expr)->value;
+        return true;
+    }
+    return false;
+}
+
+// Flattens value into columns of stride floats, in the order glUniformMatrix*fv takes them
+bool UniformBlocks::pack(const string& type, Expr::ptr value, vector<float>& columns, unsigned int& stride) {
+    if(type == "float") {
+        stride = 1;
+        columns.resize(1);
+        return value->type == NODE_FLOAT && scalar(value, columns[0]);
+    }
+
+    NodeType vectorType[] = { NODE_VECTOR2, NODE_VECTOR3, NODE_VECTOR4 };
+    NodeType matrixType[] = { NODE_MATRIX2, NODE_MATRIX3, NODE_MATRIX4 };
+    if(type == "vec2" || type == "vec3" || type == "vec4") {
+        stride = type[3] - '0';
+        if(value->type != vectorType[stride - 2]) {
+            return false;
+        }
+        Vector::ptr vec = static_pointer_cast<Vector>(value);
+        columns.resize(stride);
+        for(unsigned int i = 0; i < stride; i++) {
+            if(!scalar(vec->get(i), columns[i])) {
+                return false;
+            }
+        }
+        return true;
+    }
+    if(type == "mat2" || type == "mat3" || type == "mat4") {
+        stride = type[3] - '0';
+        if(value->type != matrixType[stride - 2]) {
+            return false;
+        }
+        Matrix::ptr mat = static_pointer_cast<Matrix>(value);
+        columns.resize(stride * stride);
+        for(unsigned int i = 0; i < stride; i++) {
+            Vector::ptr row = static_pointer_cast<Vector>(mat->get_row(i));
+            for(unsigned int j = 0; j < stride; j++) {
+                if(!scalar(row->get(j), columns[i * stride + j])) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+    return false;
+}
+
+unsigned int UniformBlocks::flush(unsigned long long* bytes) {
+    unsigned int uploads = 0;
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        Block& block = it->second;
+        if(!block.dirty || block.handle == 0) {
+            continue;
+        }
+        bindBufferBase(GL_UNIFORM_BUFFER, block.binding, block.handle);
+        gl->glBufferSubData(GL_UNIFORM_BUFFER, 0, block.data.size(), &(block.data[0]));
+        block.dirty = false;
+        uploads++;
+        *bytes += block.data.size();
+    }
+    return uploads;
+}
+
+void UniformBlocks::clear() {
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        it->second.data.assign(it->second.data.size(), 0);
+        it->second.dirty = true;
+    }
+}
+
+void UniformBlocks::release() {
+    for(auto it = blocks.begin(); it != blocks.end(); ++it) {
+        registry->release(OBJECT_BUFFER, it->second.handle);
+    }
+    blocks.clear();
+}
+
+}
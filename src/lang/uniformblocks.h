@@ -0,0 +1,78 @@
+#ifndef UNIFORMBLOCKS_H
+#define UNIFORMBLOCKS_H
+
+#include <map>
+#include <string>
+#include <vector>
+
+#include <QOpenGLFunctions>
+
+#include "nodes.h"
+#include "logwindow.h"
+#include "glregistry.h"
+
+using namespace std;
+
+namespace Wyatt {
+
+// The uniform buffers behind `uniform Name { ... }` blocks. Assigning to a member only writes a
+// CPU copy laid out by std140 rules; flush() uploads each block that changed with a single
+// glBufferSubData before the next draw, however many programs read it. The entry points are
+// resolved at open() since QOpenGLFunctions only covers ES 2.0
+class UniformBlocks {
+    public:
+        UniformBlocks(LogWindow*, GLRegistry*);
+
+        void open(QOpenGLFunctions* gl);
+        bool is_open() const { return bindBufferBase != nullptr; }
+
+        // Creates a buffer for every uniform layout, keeping the ones whose declaration didn't change
+        void update(const map<string, ProgramLayout::ptr>& layouts);
+        // Points the program's blocks at their binding points; needed after every link
+        void bind(GLuint program);
+        bool has(const string& name) const { return blocks.find(name) != blocks.end(); }
+        // Writes value into the CPU copy of block.member, logging a type mismatch
+        bool assign(Dot::ptr dot, Expr::ptr value);
+        const vector<unsigned char>& contents(const string& name) { return blocks[name].data; }
+        // Uploads the blocks assigned since the last flush; returns the number of uploads
+        unsigned int flush(unsigned long long* bytes);
+        // Zeroes every block, e.g. when the program restarts
+        void clear();
+        // Deletes the buffers, e.g. when the GL context goes away
+        void release();
+
+    private:
+        typedef void (QOPENGLF_APIENTRYP BindBufferBase)(GLenum, GLuint, GLuint);
+        typedef GLuint (QOPENGLF_APIENTRYP GetUniformBlockIndex)(GLuint, const GLchar*);
+        typedef void (QOPENGLF_APIENTRYP UniformBlockBinding)(GLuint, GLuint, GLuint);
+
+        struct Member {
+            string type;
+            unsigned int offset;
+        };
+
+        struct Block {
+            ProgramLayout::ptr layout;
+            GLuint handle = 0;
+            GLuint binding = 0;
+            map<string, Member> members;
+            vector<unsigned char> data;
+            bool dirty = false;
+        };
+
+        LogWindow* logger;
+        GLRegistry* registry;
+        QOpenGLFunctions* gl = nullptr;
+        BindBufferBase bindBufferBase = nullptr;
+        GetUniformBlockIndex getUniformBlockIndex = nullptr;
+        UniformBlockBinding uniformBlockBinding = nullptr;
+
+        map<string, Block> blocks;
+
+        bool layout_block(Block&);
+        bool pack(const string& type, Expr::ptr value, vector<float>& columns, unsigned int& stride);
+};
+
+}
+
+#endif // UNIFORMBLOCKS_H
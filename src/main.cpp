@@ -2,16 +2,57 @@
 #include <QDesktopWidget>
 
 #include "mainwindow.h"
+#include "headlessrunner.h"
 
 int main(int argc, char *argv[]) {
     QApplication app(argc, argv);
 
     std::string startupFile = "";
-    if(argc > 1) {
-        startupFile = argv[1];
+    bool headless = false;
+    bool unthrottled = false;
+    int frames = 600;
+    int width = 512, height = 512;
+    std::string trace = "";
+    std::string capture = "";
+    unsigned long long textureBudget = 256ULL * 1024 * 1024;
+    for(int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if(arg == "--headless") {
+            headless = true;
+        } else
+        if(arg == "--unthrottled") {
+            unthrottled = true;
+        } else
+        if(arg == "--frames" && i + 1 < argc) {
+            frames = std::stoi(argv[++i]);
+        } else
+        if(arg == "--trace" && i + 1 < argc) {
+            trace = argv[++i];
+        } else
+        if(arg == "--capture" && i + 1 < argc) {
+            capture = argv[++i];
+        } else
+        if(arg == "--texture-budget" && i + 1 < argc) {
+            textureBudget = std::stoull(argv[++i]) * 1024 * 1024;
+        } else
+        if(arg == "--size" && i + 2 < argc) {
+            width = std::stoi(argv[++i]);
+            height = std::stoi(argv[++i]);
+        } else {
+            startupFile = arg;
+        }
     }
-        
-    MainWindow win(0, startupFile);
+
+    if(headless) {
+        if(startupFile == "") {
+            std::cerr << "usage: wyatt --headless [--frames N] [--size W H] [--trace out.json] [--capture frames/%05d.png] [--texture-budget MB] file.gfx" << std::endl;
+            return 1;
+        }
+        HeadlessRunner runner(width, height, textureBudget);
+        return runner.run(startupFile, frames, trace, capture);
+    }
+
+    MainWindow win(0, startupFile, textureBudget, unthrottled);
     QRect screenRect = QApplication::desktop()->screenGeometry();
     win.move((screenRect.width() - win.width()) / 2, (screenRect.height() - win.height()) / 2);
     win.show();
@@ -170,6 +170,11 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
 
     while(block.isValid() && top <= event->rect().bottom()) {
         if(block.isVisible() && bottom >= event->rect().top()) {
+            auto heat = lineHeat.find(blockNumber + 1);
+            if(heat != lineHeat.end()) {
+                painter.fillRect(0, top, lineNumberArea->width(), bottom - top, QColor(255, 64, 0, int(40 + heat->second * 215)));
+            }
+
             QString number = QString::number(blockNumber + 1);
             painter.setPen(Qt::black);
             painter.setFont(monoFont);
@@ -183,6 +188,11 @@ void CodeEditor::lineNumberAreaPaintEvent(QPaintEvent *event) {
     }
 }
 
+void CodeEditor::setLineHeat(const std::map<unsigned int, float>& heat) {
+    lineHeat = heat;
+    lineNumberArea->update();
+}
+
 void CodeEditor::functionHintBoxPaintEvent(QPaintEvent*) {
     QPainter painter(functionHintBox);
 
@@ -33,6 +33,9 @@ public:
     QFileInfo fileInfo;
     QFont monoFont;
 
+    // Share of the profiled time spent on each line, from 0 to 1, drawn behind the line numbers
+    void setLineHeat(const std::map<unsigned int, float>&);
+
    static std::map<string, FuncDef::ptr> autocomplete_functions;
 
 protected:
@@ -49,6 +52,8 @@ private:
     LineNumberArea* lineNumberArea;
     FunctionHintBox* functionHintBox;
 
+    std::map<unsigned int, float> lineHeat;
+
     QString autocompleteText;
     QString currentParam;
 
@@ -2,23 +2,144 @@
 
 CustomGLWidget::CustomGLWidget(QWidget *parent = 0): QOpenGLWidget(parent)
 {
-    updateTimer = new QTimer(this);
-    updateTimer ->setInterval(17);
-    connect(updateTimer, SIGNAL(timeout()), this, SLOT(update()));
-    updateTimer->start();
+    // Keep the last image when a settled frame skips drawing
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
+
+    scheduler = new FrameScheduler(this);
+    connect(scheduler, SIGNAL(tick()), this, SLOT(update()));
+    connect(this, SIGNAL(frameSwapped()), scheduler, SLOT(frameSwapped()));
+    scheduler->start();
+
+    parseTimer = new QTimer(this);
+    parseTimer->setSingleShot(true);
+    parseTimer->setInterval(PARSE_DELAY);
+    connect(parseTimer, SIGNAL(timeout()), this, SLOT(startParse()));
+
+    editor = nullptr;
+    parsing = false;
+    parsePending = false;
 
-    codeChanged = false;
     hasResized = false;
     autoExecute = true;
+
+    lastSignature = 0;
+    staticFrames = 0;
+    settled = false;
+
+    showStats = false;
+    hotReload = false;
+    forceRestart = false;
+}
+
+void CustomGLWidget::wake() {
+    staticFrames = 0;
+    settled = false;
+    if(scheduler->idleInterval() != 0) {
+        scheduler->setIdleInterval(0);
+    }
+}
+
+// The interpreter hashes every command loop() issues; if that hash stops changing
+// the scene is static, so the scheduler backs off instead of redrawing the same image.
+// If loop() also didn't depend on time or change any state, it isn't run at all until woken
+void CustomGLWidget::detectDamage() {
+    if(interpreter->frameSignature != lastSignature) {
+        lastSignature = interpreter->frameSignature;
+        wake();
+        return;
+    }
+    if(!interpreter->dynamicFrame) {
+        settled = true;
+    }
+
+    if(++staticFrames >= STATIC_FRAMES) {
+        staticFrames = 0;
+        int interval = scheduler->idleInterval();
+        scheduler->setIdleInterval(interval == 0 ? BACKOFF_INTERVAL : std::min(interval * 2, IDLE_INTERVAL));
+    }
+}
+
+void CustomGLWidget::updateTimings() {
+    setToolTip(QString::fromStdString(
+        "Frame: " + scheduler->frameTimes.summary() + "\n" +
+        "Interpret: " + scheduler->interpretTimes.summary() + "\n" +
+        "Submit: " + scheduler->submitTimes.summary() + "\n" +
+        "Imports: " + to_string(Wyatt::ModuleCache::shared().hits()) + " cached, " +
+        to_string(Wyatt::ModuleCache::shared().misses()) + " parsed\n" +
+        "Programs: " + to_string(interpreter->programCache.hits()) + " reused, " +
+        to_string(interpreter->programCache.misses()) + " compiled\n" +
+        "Textures: " + to_string(interpreter->textureCache.hits()) + " reused, " +
+        to_string(interpreter->textureCache.misses()) + " decoded\n" +
+        interpreter->memory_report() + "\n" +
+        interpreter->registry.report() + "\n" +
+        "Disk cache: " + to_string(interpreter->diskCache.hits()) + " hits, " +
+        to_string(interpreter->diskCache.misses()) + " misses"));
+}
+
+// Sorting the histograms for their percentiles isn't worth doing every frame, only when the tooltip shows
+bool CustomGLWidget::event(QEvent* event) {
+    if(event->type() == QEvent::ToolTip) {
+        updateTimings();
+    }
+    return QOpenGLWidget::event(event);
+}
+
+void CustomGLWidget::setSwapInterval(int interval) {
+    QSurfaceFormat surface = format();
+    if(surface.swapInterval() == interval) {
+        return;
+    }
+    if(isValid()) {
+        logger->log("Swap interval " + to_string(interval) + " applies once the GL context is created again, e.g. when started with" + (interval == 0? "" : "out") + " --unthrottled");
+        return;
+    }
+    surface.setSwapInterval(interval);
+    setFormat(surface);
 }
 
 void CustomGLWidget::toggleAutoExecute(bool autoExecute) {
     this->autoExecute = autoExecute;
     if(autoExecute) {
-        updateTimer->start();
+        wake();
+        scheduler->start();
     } else {
-        updateTimer->stop();
+        scheduler->stop();
+    }
+}
+
+void CustomGLWidget::toggleStats(bool showStats) {
+    this->showStats = showStats;
+    wake();
+    update();
+}
+
+void CustomGLWidget::toggleHotReload(bool hotReload) {
+    this->hotReload = hotReload;
+}
+
+void CustomGLWidget::drawStats() {
+    vector<string> lines = counterHistory.lines();
+
+    QFont font;
+    font.setFamily("Courier");
+    font.setStyleHint(QFont::Monospace);
+    font.setPointSize(9);
+    QFontMetrics metrics(font);
+
+    int lineHeight = metrics.height();
+    int boxWidth = 0;
+    for(const string& line : lines) {
+        boxWidth = std::max(boxWidth, metrics.width(QString::fromStdString(line)));
+    }
+
+    QPainter painter(this);
+    painter.setFont(font);
+    painter.fillRect(4, 4, boxWidth + 8, lineHeight * lines.size() + 8, QColor(0, 0, 0, 160));
+    painter.setPen(Qt::white);
+    for(unsigned int i = 0; i < lines.size(); i++) {
+        painter.drawText(8, 8 + lineHeight * i, boxWidth, lineHeight, Qt::AlignLeft, QString::fromStdString(lines[i]));
     }
+    painter.end();
 }
 
 void CustomGLWidget::toggleExecute() {
@@ -26,37 +147,84 @@ void CustomGLWidget::toggleExecute() {
         QObject* source = QObject::sender();
         QPushButton* button = qobject_cast<QPushButton*>(source);
         if(button->text() == "Run") {
-            codeChanged = true;
-            updateTimer->start();
+            forceRestart = true;
+            startParse();
+            wake();
+            scheduler->start();
             button->setText("Stop");
         } else {
-            updateTimer->stop();
+            scheduler->stop();
             button->setText("Run");
         }
     }
 }
 
+// Only remembers where the code is; it's read once typing pauses for PARSE_DELAY
 void CustomGLWidget::updateCode()
 {
     QObject *source = QObject::sender();
-    CodeEditor *editor = qobject_cast<CodeEditor*>(source);
+    editor = qobject_cast<CodeEditor*>(source);
 
-    code = editor->document()->toPlainText().toStdString() + '\n';
+    wake();
     if(autoExecute) {
-        codeChanged = true;
+        parseTimer->start();
         hasResized = false;
     } else {
-        updateTimer->stop();
+        scheduler->stop();
         runButton->setText("Run");
     }
 }
 
+// Parses on the shared thread pool. Only one parse runs at a time; edits made meanwhile are
+// picked up as soon as it finishes, and its now-stale result is thrown away
+void CustomGLWidget::startParse() {
+    if(editor == nullptr) {
+        return;
+    }
+    if(parsing) {
+        parsePending = true;
+        return;
+    }
+
+    code = editor->document()->toPlainText().toStdString() + '\n';
+    logger->clear();
+    parsing = true;
+
+    std::string code = this->code;
+    std::string workingDir = interpreter->workingDir;
+    LogWindow* logger = this->logger;
+    parseJob = Wyatt::ThreadPool::shared().submit([=]() {
+        Wyatt::Script::ptr script = Wyatt::Script::build(code, workingDir, logger);
+        QMetaObject::invokeMethod(this, "finishParse", Qt::QueuedConnection);
+        return script;
+    });
+}
+
+void CustomGLWidget::finishParse() {
+    Wyatt::Script::ptr script = parseJob.get();
+    parsing = false;
+
+    if(parsePending) {
+        parsePending = false;
+        startParse();
+        return;
+    }
+
+    // A script that doesn't parse leaves the previous one running
+    if(script->status == 0) {
+        readyScript = script;
+        wake();
+        update();
+    }
+}
+
 void CustomGLWidget::initializeGL()
 {
     initializeOpenGLFunctions();
 }
 
 void CustomGLWidget::paintGL() {
+    TRACE_SCOPE("frame", "paintGL");
     if(hasResized) {
         hasResized = false;
         return;
@@ -65,24 +233,39 @@ void CustomGLWidget::paintGL() {
     glEnable(GL_DEPTH_TEST);
     glEnable(GL_CULL_FACE);
 
-    if(codeChanged) {
-        codeChanged = false;
+    if(readyScript != nullptr) {
+        Wyatt::Script::ptr script = readyScript;
+        readyScript = nullptr;
 
-        glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glClear(GL_COLOR_BUFFER_BIT);
+        if(!hotReload || forceRestart || !interpreter->hot_swap(script)) {
+            glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+            glClear(GL_COLOR_BUFFER_BIT);
 
-        logger->clear();
-        interpreter->reset();
-        interpreter->parse(code, &(interpreter->status));
-        interpreter->load_imports();
-        interpreter->setFunctions(this);
-        interpreter->prepare();
-        interpreter->compile_program();
-        interpreter->execute_init();
+            interpreter->load(script);
+            interpreter->setFunctions(this);
+            interpreter->prepare();
+            interpreter->compile_program();
+            scheduler->restartClock();
+            interpreter->set_time(0, 0);
+            interpreter->execute_init();
+        }
+        forceRestart = false;
+        counterHistory.clear();
+        lastSignature = 0;
     }
 
-    if(interpreter->status == 0) {
+    scheduler->beginFrame();
+    // The overlay is drawn over the scene, so the scene has to be drawn again under it
+    if(interpreter->status == 0 && (!settled || showStats)) {
+        interpreter->set_time(scheduler->time(), scheduler->delta());
         interpreter->execute_loop();
+        counterHistory.add(interpreter->counters);
+        detectDamage();
+    }
+    scheduler->endInterpretation();
+
+    if(showStats) {
+        drawStats();
     }
 }
 
@@ -92,14 +275,19 @@ void CustomGLWidget::resizeGL(int width, int height)
     resize(width, height);
     interpreter->resize(width, height);
     if(reparseOnResize->isChecked()) {
-        codeChanged = true;
+        forceRestart = true;
+        startParse();
     }
 
     hasResized = true;
+    wake();
 }
 
 CustomGLWidget::~CustomGLWidget()
 {
+    if(parsing) {
+        parseJob.wait();
+    }
     makeCurrent();
     doneCurrent();
 }
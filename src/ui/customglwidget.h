@@ -5,15 +5,29 @@
 #include <QOpenGLFunctions>
 #include <QAction>
 #include <QPushButton>
+#include <QPainter>
 #include <QTimer>
 
 #include "codeeditor.h"
 #include "interpreter.h"
+#include "framescheduler.h"
+#include "modulecache.h"
+#include "script.h"
+#include "threadpool.h"
 
 #include <iostream>
 #include <cstring>
+#include <future>
 #include <map>
 
+// First interval the scheduler backs off to once the scene stops changing, and its ceiling
+#define BACKOFF_INTERVAL 34
+#define IDLE_INTERVAL 1000
+// Number of identical frames before the scene is considered static
+#define STATIC_FRAMES 30
+// How long typing has to pause before the code is reparsed
+#define PARSE_DELAY 150
+
 class CustomGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 {
     Q_OBJECT
@@ -25,11 +39,13 @@ class CustomGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
         void initializeGL();
         void paintGL();
         void resizeGL(int, int);
+        // 0 lets frames run past the display's refresh. The context only picks this up when it's
+        // created, so a change made once the widget is showing applies after it's created again
+        void setSwapInterval(int);
 
         LogWindow* logger;
         Wyatt::Interpreter* interpreter;
 
-        bool codeChanged;
         bool hasResized;
         bool autoExecute;
 
@@ -38,14 +54,50 @@ class CustomGLWidget : public QOpenGLWidget, protected QOpenGLFunctions
 
         QPushButton* runButton;
 
+        FrameScheduler* scheduler;
+        Wyatt::CounterHistory counterHistory;
+
     private:
         std::string code;
-        QTimer* updateTimer;
+        CodeEditor* editor;
+
+        QTimer* parseTimer;
+        std::future<Wyatt::Script::ptr> parseJob;
+        bool parsing;
+        bool parsePending;
+        // Parsed on a worker, waiting for the next paintGL to swap it in
+        Wyatt::Script::ptr readyScript;
+
+        unsigned long long lastSignature;
+        int staticFrames;
+        // The last loop() issued what the one before did and read nothing that changes between
+        // frames, so until something wakes the widget it isn't run again and its image stays up
+        bool settled;
+
+        bool showStats;
+        // Keep globals and GL resources across edits that don't touch init()
+        bool hotReload;
+        // Set by Run and by resizing, which restart the program even with hot reload on
+        bool forceRestart;
+
+        void wake();
+        void detectDamage();
+        void updateTimings();
+        void drawStats();
+
+    protected:
+        bool event(QEvent*);
 
     public slots:
         void updateCode();
         void toggleAutoExecute(bool);
         void toggleExecute();
+        void toggleStats(bool);
+        void toggleHotReload(bool);
+
+    private slots:
+        void startParse();
+        void finishParse();
 };
 
 #endif // CUSTOMGLWIDGET_H
@@ -0,0 +1,113 @@
+#include "framescheduler.h"
+
+FrameScheduler::FrameScheduler(QObject *parent): QObject(parent)
+{
+    timer = new QTimer(this);
+    timer->setSingleShot(true);
+    timer->setTimerType(Qt::PreciseTimer);
+    connect(timer, SIGNAL(timeout()), this, SLOT(fire()));
+
+    clock.start();
+}
+
+void FrameScheduler::setMode(Mode mode, int rate) {
+    currentMode = mode;
+    fixedRate = rate > 0 ? rate : 60;
+    deadline = now();
+    if(active) {
+        schedule();
+    }
+}
+
+void FrameScheduler::setIdleInterval(int ms) {
+    bool waking = idle > 0 && ms == 0;
+    idle = ms;
+    if(waking && active) {
+        // Don't sit out the rest of a long idle wait once the scene starts changing again
+        deadline = now();
+        arm(deadline);
+    }
+}
+
+void FrameScheduler::start() {
+    active = true;
+    deadline = now();
+    arm(deadline);
+}
+
+void FrameScheduler::stop() {
+    active = false;
+    timer->stop();
+}
+
+float FrameScheduler::time() const {
+    return (now() - epoch) / 1e9;
+}
+
+void FrameScheduler::restartClock() {
+    epoch = now();
+    frameStart = -1;
+    deltaSeconds = 0;
+}
+
+void FrameScheduler::beginFrame() {
+    qint64 t = now();
+    if(frameStart >= 0) {
+        deltaSeconds = (t - frameStart) / 1e9;
+        frameTimes.add((t - frameStart) / 1e6);
+    }
+    frameStart = t;
+    interpretEnd = -1;
+}
+
+void FrameScheduler::endInterpretation() {
+    interpretEnd = now();
+    interpretTimes.add((interpretEnd - frameStart) / 1e6);
+}
+
+void FrameScheduler::frameSwapped() {
+    if(interpretEnd >= 0) {
+        submitTimes.add((now() - interpretEnd) / 1e6);
+        interpretEnd = -1;
+    }
+    if(active) {
+        schedule();
+    }
+}
+
+void FrameScheduler::fire() {
+    if(!active) {
+        return;
+    }
+    // If the frame this tick requests never reaches the screen, tick again rather than stall
+    arm(now() + qint64(FRAME_WATCHDOG) * 1000000);
+    emit tick();
+}
+
+// Deadlines advance by whole periods from the previous one rather than from when the
+// frame finished, so a fixed rate doesn't drift by however long each frame took
+void FrameScheduler::schedule() {
+    qint64 t = now();
+
+    if(idle > 0) {
+        deadline = t + qint64(idle) * 1000000;
+    } else if(currentMode == FIXED) {
+        qint64 period = 1000000000LL / fixedRate;
+        deadline += period;
+        if(deadline < t - period) {
+            // Fell more than a frame behind; skip the missed frames instead of bursting to catch up
+            deadline = t;
+        }
+    } else {
+        // Under VSYNC the swap itself waited on the display, so the next frame can start right away;
+        // UNTHROTTLED does the same, but its context swaps with interval 0 so nothing waits
+        deadline = t;
+    }
+
+    arm(deadline);
+}
+
+void FrameScheduler::arm(qint64 at) {
+    qint64 wait = (at - now()) / 1000000;
+    timer->start(wait > 0 ? int(wait) : 0);
+}
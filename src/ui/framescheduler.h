@@ -0,0 +1,79 @@
+#ifndef FRAMESCHEDULER_H
+#define FRAMESCHEDULER_H
+
+#include <QObject>
+#include <QElapsedTimer>
+#include <QTimer>
+
+#include "stats.h"
+
+// Longest a tick may go unanswered before the scheduler assumes the frame was dropped
+#define FRAME_WATCHDOG 1000
+
+// Paces repaints against either the display's swap interval or a fixed rate, and keeps
+// frame, interpretation and submission timings for the widget to report
+class FrameScheduler : public QObject
+{
+    Q_OBJECT
+
+    public:
+        enum Mode {
+            VSYNC, FIXED, UNTHROTTLED
+        };
+
+        explicit FrameScheduler(QObject *parent);
+
+        void setMode(Mode, int rate = 60);
+        Mode mode() const { return currentMode; }
+        int rate() const { return fixedRate; }
+
+        // Ticks at most once per interval while the scene is static; 0 paces normally
+        void setIdleInterval(int ms);
+        int idleInterval() const { return idle; }
+
+        void start();
+        void stop();
+        bool isActive() const { return active; }
+
+        // Seconds since restartClock(), and between the last two frames
+        float time() const;
+        float delta() const { return deltaSeconds; }
+        void restartClock();
+
+        void beginFrame();
+        void endInterpretation();
+
+        Wyatt::TimingHistogram frameTimes;
+        Wyatt::TimingHistogram interpretTimes;
+        Wyatt::TimingHistogram submitTimes;
+
+    signals:
+        void tick();
+
+    public slots:
+        void frameSwapped();
+
+    private slots:
+        void fire();
+
+    private:
+        Mode currentMode = VSYNC;
+        int fixedRate = 60;
+        int idle = 0;
+        bool active = false;
+
+        QElapsedTimer clock;
+        QTimer* timer;
+
+        qint64 epoch = 0;
+        qint64 deadline = 0;
+        qint64 frameStart = -1;
+        qint64 interpretEnd = -1;
+        float deltaSeconds = 0;
+
+        qint64 now() const { return clock.nsecsElapsed(); }
+        void schedule();
+        void arm(qint64 at);
+};
+
+#endif // FRAMESCHEDULER_H
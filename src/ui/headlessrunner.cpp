@@ -0,0 +1,98 @@
+#include "headlessrunner.h"
+
+HeadlessRunner::HeadlessRunner(int width, int height, unsigned long long textureBudget): width(width), height(height)
+{
+    logger = new LogWindow(0);
+    logger->echo = true;
+    interpreter = new Wyatt::Interpreter(logger);
+    interpreter->textureCache.budget = textureBudget;
+    // Nothing is shown while it runs, so captures wait for the disk rather than being dropped
+    interpreter->frameCapture.blocking = true;
+}
+
+int HeadlessRunner::run(std::string file, int frames, std::string trace, std::string capture) {
+    Wyatt::Trace::set_enabled(trace != "");
+
+    surface.create();
+    if(!context.create() || !context.makeCurrent(&surface)) {
+        std::cerr << "Cannot create an OpenGL context" << std::endl;
+        return 1;
+    }
+    functions.initializeOpenGLFunctions();
+
+    QOpenGLFramebufferObjectFormat format;
+    format.setAttachment(QOpenGLFramebufferObject::CombinedDepthStencil);
+    screen = new QOpenGLFramebufferObject(width, height, format);
+    if(!screen->isValid() || !screen->bind()) {
+        std::cerr << "Cannot create a " << width << "x" << height << " framebuffer" << std::endl;
+        return 1;
+    }
+
+    QFileInfo info(QString::fromStdString(file));
+    interpreter->workingDir = info.absolutePath().toStdString();
+
+    interpreter->load(Wyatt::Script::build(str_from_file(file) + '\n', interpreter->workingDir, logger));
+    interpreter->resize(width, height);
+    interpreter->setFunctions(&functions);
+    interpreter->prepare();
+    interpreter->compile_program();
+    interpreter->set_time(0, 0);
+    interpreter->execute_init();
+    if(interpreter->status != 0) {
+        return 1;
+    }
+
+    counterHistory = Wyatt::CounterHistory(frames > 0 ? frames : 1);
+
+    // Time advances by a fixed step so that two runs of the same script issue the same work
+    float step = 1.0f / 60.0f;
+    for(int i = 0; i < frames; i++) {
+        interpreter->set_time(i * step, step);
+        interpreter->execute_loop();
+        if(capture != "") {
+            interpreter->capture_screen(capture);
+        }
+        functions.glFinish();
+        counterHistory.add(interpreter->counters);
+    }
+
+    interpreter->frameCapture.flush();
+
+    vector<string> lines = counterHistory.lines();
+    for(const string& line : lines) {
+        std::cout << line << std::endl;
+    }
+    std::cout << "imports  " << Wyatt::ModuleCache::shared().hits() << " cached, "
+              << Wyatt::ModuleCache::shared().misses() << " parsed" << std::endl;
+    std::cout << "programs " << interpreter->programCache.hits() << " reused, "
+              << interpreter->programCache.misses() << " compiled" << std::endl;
+    std::cout << "textures " << interpreter->textureCache.hits() << " reused, "
+              << interpreter->textureCache.misses() << " decoded" << std::endl;
+    std::cout << interpreter->memory_report() << std::endl;
+    std::cout << interpreter->registry.report() << std::endl;
+    std::cout << "captures " << interpreter->frameCapture.written() << " written, "
+              << interpreter->frameCapture.dropped() << " dropped" << std::endl;
+    std::cout << "disk     " << interpreter->diskCache.hits() << " hits, "
+              << interpreter->diskCache.misses() << " misses" << std::endl;
+
+    delete screen;
+    screen = nullptr;
+    context.doneCurrent();
+
+    if(trace != "" && !Wyatt::Trace::write(trace)) {
+        std::cerr << "Cannot write trace to " << trace << std::endl;
+        return 1;
+    }
+    return 0;
+}
+
+HeadlessRunner::~HeadlessRunner()
+{
+    // Left over when the script failed to start
+    if(screen != nullptr && context.makeCurrent(&surface)) {
+        delete screen;
+        context.doneCurrent();
+    }
+    delete interpreter;
+    delete logger;
+}
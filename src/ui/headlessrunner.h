@@ -0,0 +1,44 @@
+#ifndef HEADLESSRUNNER_H
+#define HEADLESSRUNNER_H
+
+#include <QFileInfo>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFramebufferObject>
+#include <QOpenGLFunctions>
+
+#include "interpreter.h"
+#include "logwindow.h"
+#include "modulecache.h"
+#include "stats.h"
+
+#include <iostream>
+#include <string>
+
+// Runs a script against an offscreen context for a fixed number of frames, without showing a window
+class HeadlessRunner
+{
+    public:
+        HeadlessRunner(int width, int height, unsigned long long textureBudget);
+        ~HeadlessRunner();
+
+        // capture is a file name pattern every frame is written to; see Wyatt::FrameCapture
+        int run(std::string file, int frames, std::string trace = "", std::string capture = "");
+
+        Wyatt::CounterHistory counterHistory;
+
+    private:
+        int width, height;
+
+        QOffscreenSurface surface;
+        QOpenGLContext context;
+        QOpenGLFunctions functions;
+        // What the script draws to the screen lands in; an offscreen surface's own framebuffer may
+        // not exist, or not be the requested size
+        QOpenGLFramebufferObject* screen = nullptr;
+
+        LogWindow* logger;
+        Wyatt::Interpreter* interpreter;
+};
+
+#endif // HEADLESSRUNNER_H
@@ -11,7 +11,7 @@ Highlighter::Highlighter(QTextDocument *parent): QSyntaxHighlighter(parent)
     keywordFormat.setForeground(QColor(0, 153, 153));
     keywordFormat.setFontWeight(70);
     QStringList keywordPatterns;
-    keywordPatterns << "\\buse\\b" << "\\ballocate\\b" << "\\bdraw\\b" << "\\bto\\b" << "\\busing\\b" << "\\btrue\\b" << "\\bfalse\\b" << "\\band\\b" << "\\bor\\b" << "\\bfunc\\b" << "\\bprint\\b" << "\\bimport\\b";
+    keywordPatterns << "\\buse\\b" << "\\ballocate\\b" << "\\bdraw\\b" << "\\bto\\b" << "\\busing\\b" << "\\btrue\\b" << "\\bfalse\\b" << "\\band\\b" << "\\bor\\b" << "\\bfunc\\b" << "\\bprint\\b" << "\\bcapture\\b" << "\\bimport\\b";
 
     foreach(const QString &pattern, keywordPatterns) {
         rule.pattern = QRegularExpression(pattern);
@@ -31,7 +31,7 @@ Highlighter::Highlighter(QTextDocument *parent): QSyntaxHighlighter(parent)
     typeFormat.setForeground(QColor(128, 0, 255));
     typeFormat.setFontWeight(60);
     QStringList typePatterns;
-    typePatterns << "\\bint\\b" << "\\bfloat\\b" << "\\bbool\\b" << "\\bbuffer\\b" << "\\btexture2D\\b" << "\\bvec2\\b" << "\\bvec3\\b" << "\\bvec4\\b" << "\\bmat2\\b" << "\\bmat3\\b" << "\\bmat4\\b";
+    typePatterns << "\\bint\\b" << "\\bfloat\\b" << "\\bbool\\b" << "\\bbuffer\\b" << "\\btexture2D\\b" << "\\bpingpong\\b" << "\\bvec2\\b" << "\\bvec3\\b" << "\\bvec4\\b" << "\\bmat2\\b" << "\\bmat3\\b" << "\\bmat4\\b";
     foreach(const QString &pattern, typePatterns) {
         rule.pattern = QRegularExpression(pattern);
         rule.format = typeFormat;
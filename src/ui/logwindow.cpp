@@ -12,11 +12,26 @@ LogWindow::LogWindow(QWidget *parent = 0): QPlainTextEdit(parent)
 
     QFontMetrics metrics(monoFont);
     this->setTabStopWidth(4 * metrics.width(' '));
+
+    connect(this, SIGNAL(logRequested(QString)), this, SLOT(write(QString)), Qt::QueuedConnection);
+    connect(this, SIGNAL(clearRequested()), this, SLOT(erase()), Qt::QueuedConnection);
 }
 
 void LogWindow::log(string msg) {
+    if(echo) {
+        cerr << msg << endl;
+    }
+
+    if(QThread::currentThread() == thread()) {
+        write(QString::fromStdString(msg));
+    } else {
+        emit logRequested(QString::fromStdString(msg));
+    }
+}
+
+void LogWindow::write(QString msg) {
     this->moveCursor(QTextCursor::End);
-    this->insertPlainText(QString::fromStdString(msg + '\n'));
+    this->insertPlainText(msg + '\n');
     this->moveCursor(QTextCursor::End);
 }
 
@@ -50,6 +65,14 @@ void LogWindow::log(shared_ptr<Node> node, string label, string msg) {
 }
 
 void LogWindow::clear() {
+    if(QThread::currentThread() == thread()) {
+        erase();
+    } else {
+        emit clearRequested();
+    }
+}
+
+void LogWindow::erase() {
     this->setPlainText("");
 }
 
@@ -5,6 +5,7 @@
 #include <string>
 #include <QPlainTextEdit>
 #include <QTextCursor>
+#include <QThread>
 
 #include "nodes.h"
 
@@ -16,15 +17,29 @@ struct LogInfo {
     unsigned int first_column = 0, last_column = 0;
 };
 
+// Can be logged to from any thread; messages from other threads are queued onto the window's own
 class LogWindow : public QPlainTextEdit
 {
+    Q_OBJECT
+
     public:
         explicit LogWindow(QWidget *parent);
 
+        // Also write every message to stderr, for when the window is never shown
+        bool echo = false;
+
         void log(string);
         void log(LogInfo info, string);
         void log(Node::ptr, string, string);
         void clear();
+
+    signals:
+        void logRequested(QString);
+        void clearRequested();
+
+    private slots:
+        void write(QString);
+        void erase();
 };
 
 #endif // LOGWINDOW_H
@@ -1,6 +1,6 @@
 #include "mainwindow.h"
 
-MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(parent)
+MainWindow::MainWindow(QWidget *parent, std::string startupFile, unsigned long long textureBudget, bool unthrottled) : QMainWindow(parent)
 {
     resize(800, 600);
     setAnimated(true);
@@ -22,11 +22,31 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
     action16_9->setCheckable(true);
     actionRestart_on_Resize = new QAction(this);
     actionRestart_on_Resize->setCheckable(true);
+    actionVSync = new QAction(this);
+    actionVSync->setCheckable(true);
+    action60_FPS = new QAction(this);
+    action60_FPS->setCheckable(true);
+    action30_FPS = new QAction(this);
+    action30_FPS->setCheckable(true);
+    actionUnthrottled = new QAction(this);
+    actionUnthrottled->setCheckable(true);
 
     QAction* actionAuto_Execute = new QAction(this);
     actionAuto_Execute->setCheckable(true);
     actionAuto_Execute->setChecked(true);
 
+    QAction* actionShow_Statistics = new QAction(this);
+    actionShow_Statistics->setCheckable(true);
+
+    QAction* actionHot_Reload = new QAction(this);
+    actionHot_Reload->setCheckable(true);
+
+    QAction* actionProfile = new QAction(this);
+    actionProfile->setCheckable(true);
+
+    QAction* actionRecord_Trace = new QAction(this);
+    actionRecord_Trace->setCheckable(true);
+
     connect(actionNew, &QAction::triggered, this, &MainWindow::newFile);
     connect(actionOpen, &QAction::triggered, this, &MainWindow::openFile);
     connect(actionSave, &QAction::triggered, this, &MainWindow::saveFile);
@@ -45,6 +65,18 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
     connect(action16_9, &QAction::triggered, this, &MainWindow::switchAspectRatio);
     aspectRatioGroup->setExclusive(true);
 
+    frameRateGroup = new QActionGroup(this);
+    actionVSync->setChecked(true);
+    frameRateGroup->addAction(actionVSync);
+    frameRateGroup->addAction(action60_FPS);
+    frameRateGroup->addAction(action30_FPS);
+    frameRateGroup->addAction(actionUnthrottled);
+    connect(actionVSync, &QAction::triggered, this, &MainWindow::switchFrameRate);
+    connect(action60_FPS, &QAction::triggered, this, &MainWindow::switchFrameRate);
+    connect(action30_FPS, &QAction::triggered, this, &MainWindow::switchFrameRate);
+    connect(actionUnthrottled, &QAction::triggered, this, &MainWindow::switchFrameRate);
+    frameRateGroup->setExclusive(true);
+
     centralWidget = new QWidget(this);
     centralLayout = new QGridLayout(centralWidget);
     centralLayout->setSpacing(6);
@@ -113,6 +145,7 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
     menuFile = new QMenu(menuBar);
     menuOptions = new QMenu(menuBar);
     menuAspect_Ratio = new QMenu(menuOptions);
+    menuFrame_Rate = new QMenu(menuOptions);
     setMenuBar(menuBar);
 
     menuBar->addAction(menuFile->menuAction());
@@ -123,12 +156,21 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
     menuFile->addAction(actionSave_As);
     menuFile->addAction(actionClose_Tab);
     menuOptions->addAction(menuAspect_Ratio->menuAction());
+    menuOptions->addAction(menuFrame_Rate->menuAction());
     menuOptions->addAction(actionRestart_on_Resize);
     menuOptions->addAction(actionAuto_Execute);
+    menuOptions->addAction(actionHot_Reload);
+    menuOptions->addAction(actionShow_Statistics);
+    menuOptions->addAction(actionProfile);
+    menuOptions->addAction(actionRecord_Trace);
     menuAspect_Ratio->addAction(action1_1);
     menuAspect_Ratio->addAction(action3_2);
     menuAspect_Ratio->addAction(action4_3);
     menuAspect_Ratio->addAction(action16_9);
+    menuFrame_Rate->addAction(actionVSync);
+    menuFrame_Rate->addAction(action60_FPS);
+    menuFrame_Rate->addAction(action30_FPS);
+    menuFrame_Rate->addAction(actionUnthrottled);
 
     setWindowTitle(QApplication::translate("MainWindow", "Wyatt", Q_NULLPTR));
 
@@ -146,12 +188,21 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
     action3_2->setText(QApplication::translate("MainWindow", "3:2", Q_NULLPTR));
     action4_3->setText(QApplication::translate("MainWindow", "4:3", Q_NULLPTR));
     action16_9->setText(QApplication::translate("MainWindow", "16:9", Q_NULLPTR));
+    actionVSync->setText(QApplication::translate("MainWindow", "VSync", Q_NULLPTR));
+    action60_FPS->setText(QApplication::translate("MainWindow", "60 FPS", Q_NULLPTR));
+    action30_FPS->setText(QApplication::translate("MainWindow", "30 FPS", Q_NULLPTR));
+    actionUnthrottled->setText(QApplication::translate("MainWindow", "Unthrottled", Q_NULLPTR));
     actionRestart_on_Resize->setText(QApplication::translate("MainWindow", "Restart on Resize", Q_NULLPTR));
     actionAuto_Execute->setText(QApplication::translate("MainWindow", "Auto-execute", Q_NULLPTR));
+    actionHot_Reload->setText(QApplication::translate("MainWindow", "Hot Reload", Q_NULLPTR));
+    actionShow_Statistics->setText(QApplication::translate("MainWindow", "Show Statistics", Q_NULLPTR));
+    actionProfile->setText(QApplication::translate("MainWindow", "Profile", Q_NULLPTR));
+    actionRecord_Trace->setText(QApplication::translate("MainWindow", "Record Trace", Q_NULLPTR));
     editors->setTabText(editors->indexOf(tab), QApplication::translate("MainWindow", "untitled", Q_NULLPTR));
     menuFile->setTitle(QApplication::translate("MainWindow", "File", Q_NULLPTR));
     menuOptions->setTitle(QApplication::translate("MainWindow", "Options", Q_NULLPTR));
     menuAspect_Ratio->setTitle(QApplication::translate("MainWindow", "Aspect Ratio", Q_NULLPTR));
+    menuFrame_Rate->setTitle(QApplication::translate("MainWindow", "Frame Rate", Q_NULLPTR));
 
     editors->setCurrentIndex(0);
     editors->setTabsClosable(true);
@@ -191,8 +242,23 @@ MainWindow::MainWindow(QWidget *parent, std::string startupFile) : QMainWindow(p
 
     connect(actionAuto_Execute, SIGNAL(triggered(bool)), openGLWidget, SLOT(toggleAutoExecute(bool)));
     connect(actionAuto_Execute, SIGNAL(triggered(bool)), runButton, SLOT(setDisabled(bool)));
+    connect(actionHot_Reload, SIGNAL(triggered(bool)), openGLWidget, SLOT(toggleHotReload(bool)));
+    connect(actionShow_Statistics, SIGNAL(triggered(bool)), openGLWidget, SLOT(toggleStats(bool)));
 
     openGLWidget->interpreter = new Wyatt::Interpreter(logWindow);
+    openGLWidget->interpreter->textureCache.budget = textureBudget;
+
+    // Picked before the window shows, so the context is created with the right swap interval
+    if(unthrottled) {
+        actionUnthrottled->setChecked(true);
+        switchFrameRate();
+    }
+
+    profilerWindow = new ProfilerWindow(this);
+    profilerWindow->interpreter = openGLWidget->interpreter;
+    profilerWindow->editor = currentEditor;
+    connect(actionProfile, SIGNAL(triggered(bool)), profilerWindow, SLOT(setProfiling(bool)));
+    connect(actionRecord_Trace, &QAction::triggered, this, &MainWindow::toggleTrace);
 
     txtFilter = tr("GFX files (*.gfx)");
 }
@@ -214,6 +280,43 @@ void MainWindow::switchAspectRatio() {
     openGLWidget->resizeGL(openGLWidget->width(), 0);
 }
 
+void MainWindow::switchFrameRate() {
+    string selected = frameRateGroup->checkedAction()->text().toStdString();
+    if(selected == "VSync") {
+        openGLWidget->scheduler->setMode(FrameScheduler::VSYNC);
+    }
+    if(selected == "60 FPS") {
+        openGLWidget->scheduler->setMode(FrameScheduler::FIXED, 60);
+    }
+    if(selected == "30 FPS") {
+        openGLWidget->scheduler->setMode(FrameScheduler::FIXED, 30);
+    }
+    if(selected == "Unthrottled") {
+        openGLWidget->scheduler->setMode(FrameScheduler::UNTHROTTLED);
+    }
+    openGLWidget->setSwapInterval(selected == "Unthrottled"? 0 : 1);
+}
+
+void MainWindow::toggleTrace(bool recording) {
+    if(recording) {
+        Wyatt::Trace::clear();
+        Wyatt::Trace::set_enabled(true);
+        return;
+    }
+
+    Wyatt::Trace::set_enabled(false);
+    openGLWidget->setUpdatesEnabled(false);
+    QString selected = QFileDialog::getSaveFileName(this, tr("Save Trace"), Q_NULLPTR, tr("Trace files (*.json)"));
+    openGLWidget->setUpdatesEnabled(true);
+    if(selected == Q_NULLPTR) {
+        return;
+    }
+
+    if(!Wyatt::Trace::write(selected.toStdString())) {
+        logWindow->log("Cannot write trace to " + selected.toStdString());
+    }
+}
+
 void MainWindow::closeTab(int tab) {
     CodeEditor* editor = qobject_cast<CodeEditor*>(editors->widget(tab)->findChild<QPlainTextEdit*>());
     QString file = editor->fileInfo.fileName();
@@ -236,11 +339,13 @@ void MainWindow::closeTab(int tab) {
 void MainWindow::switchTab(int newTab) {
     if(currentEditor != nullptr) {
         disconnect(currentEditor, SIGNAL(textChanged()), 0, 0);
+        currentEditor->setLineHeat(std::map<unsigned int, float>());
     }
     editors->setCurrentIndex(newTab);
     currentEditor = qobject_cast<CodeEditor*>(editors->currentWidget()->findChild<QPlainTextEdit*>());
     highlighter->setDocument(currentEditor->document());
     connect(currentEditor, SIGNAL(textChanged()), openGLWidget, SLOT(updateCode()));
+    profilerWindow->editor = currentEditor;
 
     openGLWidget->interpreter->workingDir = currentEditor->fileInfo.absolutePath().toStdString();
 
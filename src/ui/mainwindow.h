@@ -26,6 +26,7 @@
 #include "customglwidget.h"
 #include "codeeditor.h"
 #include "highlighter.h"
+#include "profilerwindow.h"
 #include "helper.h"
 
 class MainWindow : public QMainWindow
@@ -33,7 +34,7 @@ class MainWindow : public QMainWindow
     Q_OBJECT
 
 public:
-    explicit MainWindow(QWidget *parent = 0, std::string startupFile = "");
+    explicit MainWindow(QWidget *parent = 0, std::string startupFile = "", unsigned long long textureBudget = 256ULL * 1024 * 1024, bool unthrottled = false);
     ~MainWindow();
 
     void updateCode();
@@ -49,6 +50,10 @@ private:
     QAction *action4_3;
     QAction *action16_9;
     QAction *actionRestart_on_Resize;
+    QAction *actionVSync;
+    QAction *action60_FPS;
+    QAction *action30_FPS;
+    QAction *actionUnthrottled;
     QWidget *centralWidget;
     QGridLayout *centralLayout;
     QSplitter *hSplit;
@@ -61,11 +66,13 @@ private:
     QWidget *hSplitWidget;
     QVBoxLayout *hSplitLayout;
     CustomGLWidget *openGLWidget;
+    ProfilerWindow *profilerWindow;
     QPushButton *runButton;
     QMenuBar *menuBar;
     QMenu *menuFile;
     QMenu *menuOptions;
     QMenu *menuAspect_Ratio;
+    QMenu *menuFrame_Rate;
 
     CodeEditor* currentEditor;
     Highlighter* highlighter;
@@ -79,9 +86,12 @@ private:
     int createOpenTab(QString, QString);
 
     QActionGroup* aspectRatioGroup;
+    QActionGroup* frameRateGroup;
 
 private slots:
     void switchAspectRatio();
+    void switchFrameRate();
+    void toggleTrace(bool);
     void closeTab(int tab);
     void switchTab(int newTab);
 
@@ -0,0 +1,76 @@
+#include "profilerwindow.h"
+
+ProfilerWindow::ProfilerWindow(QWidget *parent = 0): QTableWidget(parent)
+{
+    setWindowFlags(Qt::Tool);
+    setWindowTitle("Profiler");
+    resize(480, 300);
+
+    setColumnCount(4);
+    setHorizontalHeaderLabels(QStringList() << "Function" << "Calls/frame" << "Inclusive (ms)" << "Exclusive (ms)");
+    horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    setEditTriggers(QAbstractItemView::NoEditTriggers);
+    setSortingEnabled(true);
+
+    interpreter = nullptr;
+    editor = nullptr;
+
+    refreshTimer = new QTimer(this);
+    refreshTimer->setInterval(PROFILER_REFRESH);
+    connect(refreshTimer, SIGNAL(timeout()), this, SLOT(refresh()));
+}
+
+void ProfilerWindow::setProfiling(bool profiling) {
+    interpreter->profiler.clear();
+    interpreter->profiler.enabled = profiling;
+
+    if(profiling) {
+        refreshTimer->start();
+        show();
+    } else {
+        refreshTimer->stop();
+        hide();
+        if(editor != nullptr) {
+            editor->setLineHeat(std::map<unsigned int, float>());
+        }
+    }
+}
+
+void ProfilerWindow::refresh() {
+    Wyatt::Profiler& profiler = interpreter->profiler;
+    double frames = profiler.frames > 0 ? profiler.frames : 1;
+
+    // Rows are refilled in place; sorting has to be off while that happens or rows move under us
+    setSortingEnabled(false);
+    clearContents();
+    setRowCount(profiler.functions.size());
+
+    int row = 0;
+    for(auto it = profiler.functions.begin(); it != profiler.functions.end(); ++it, ++row) {
+        QTableWidgetItem* calls = new QTableWidgetItem();
+        QTableWidgetItem* inclusive = new QTableWidgetItem();
+        QTableWidgetItem* exclusive = new QTableWidgetItem();
+        calls->setData(Qt::DisplayRole, it->second.calls / frames);
+        inclusive->setData(Qt::DisplayRole, it->second.inclusiveMs / frames);
+        exclusive->setData(Qt::DisplayRole, it->second.exclusiveMs / frames);
+
+        setItem(row, 0, new QTableWidgetItem(QString::fromStdString(it->first)));
+        setItem(row, 1, calls);
+        setItem(row, 2, inclusive);
+        setItem(row, 3, exclusive);
+    }
+    setSortingEnabled(true);
+
+    if(editor != nullptr) {
+        double hottest = 0;
+        for(auto it = profiler.lines.begin(); it != profiler.lines.end(); ++it) {
+            hottest = std::max(hottest, it->second.selfMs);
+        }
+
+        std::map<unsigned int, float> heat;
+        for(auto it = profiler.lines.begin(); it != profiler.lines.end(); ++it) {
+            heat[it->first] = hottest > 0 ? it->second.selfMs / hottest : 0;
+        }
+        editor->setLineHeat(heat);
+    }
+}
@@ -0,0 +1,32 @@
+#ifndef PROFILERWINDOW_H
+#define PROFILERWINDOW_H
+
+#include <QTableWidget>
+#include <QHeaderView>
+#include <QTimer>
+
+#include "codeeditor.h"
+#include "interpreter.h"
+
+// How often the table and the editor's heatmap pick up new profiling data
+#define PROFILER_REFRESH 500
+
+class ProfilerWindow : public QTableWidget
+{
+    Q_OBJECT
+
+    public:
+        explicit ProfilerWindow(QWidget *parent);
+
+        Wyatt::Interpreter* interpreter;
+        CodeEditor* editor;
+
+    public slots:
+        void setProfiling(bool);
+        void refresh();
+
+    private:
+        QTimer* refreshTimer;
+};
+
+#endif // PROFILERWINDOW_H
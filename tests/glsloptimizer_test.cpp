@@ -0,0 +1,119 @@
+// Optimizes hand-built shader pairs and checks what the folding left; exits non-zero if any check
+// fails. Nothing is logged unless transpiling fails, so no LogWindow is created
+#include <cstdio>
+#include <string>
+
+#include "glsloptimizer.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if(!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static Decl::ptr declare(const string& datatype, const string& name, Expr::ptr value) {
+    return make_shared<Decl>(make_shared<Ident>(datatype), make_shared<Ident>(name), value);
+}
+
+// A pair whose fragment shader declares uniforms (and constants) and runs stmts in main, writing
+// a float output named value
+static ShaderPair::ptr make_pair(shared_ptr<vector<Decl::ptr>> uniforms, Stmts::ptr stmts) {
+    auto vertexFunctions = make_shared<map<string, FuncDef::ptr>>();
+    Stmts::ptr vertexBody = make_shared<Stmts>(make_shared<Assign>(make_shared<Ident>("FinalPosition"), make_shared<Ident>("position")));
+    (*vertexFunctions)["main"] = make_shared<FuncDef>(make_shared<Ident>("main"), make_shared<ParamList>(nullptr), vertexBody);
+    ParamList::ptr vertexInputs = make_shared<ParamList>(declare("vec4", "position", nullptr));
+    ParamList::ptr vertexOutputs = make_shared<ParamList>(declare("vec4", "FinalPosition", nullptr));
+
+    auto fragmentFunctions = make_shared<map<string, FuncDef::ptr>>();
+    (*fragmentFunctions)["main"] = make_shared<FuncDef>(make_shared<Ident>("main"), make_shared<ParamList>(nullptr), stmts);
+    ParamList::ptr fragmentOutputs = make_shared<ParamList>(declare("float", "value", nullptr));
+
+    ShaderPair::ptr pair = make_shared<ShaderPair>();
+    pair->name = "test";
+    pair->vertex = make_shared<Shader>("test", make_shared<vector<Decl::ptr>>(), vertexFunctions, vertexInputs, vertexOutputs);
+    pair->fragment = make_shared<Shader>("test", uniforms, fragmentFunctions, make_shared<ParamList>(nullptr), fragmentOutputs);
+    return pair;
+}
+
+// What main ends up assigning to value, or nullptr if it no longer does
+static Expr::ptr optimized_value(ShaderPair::ptr pair) {
+    map<string, ProgramLayout::ptr> layouts;
+    GLSLTranspiler transpiler(nullptr);
+    transpiler.layouts = &layouts;
+    GLSLOptimizer optimizer(&transpiler);
+    ShaderPair::ptr result = optimizer.optimize(pair);
+
+    Stmts::ptr stmts = result->fragment->functions->at("main")->stmts;
+    for(auto it = stmts->list.begin(); it != stmts->list.end(); ++it) {
+        if((*it)->type == NODE_ASSIGN) {
+            return static_pointer_cast<Assign>(*it)->value;
+        }
+    }
+    return nullptr;
+}
+
+static Stmt::ptr assign_value(Expr::ptr value) {
+    return make_shared<Assign>(make_shared<Ident>("value"), value);
+}
+
+static bool is_float(Expr::ptr expr, float value) {
+    return expr != nullptr && expr->type == NODE_FLOAT && static_pointer_cast<Float>(expr)->value == value;
+}
+
+static bool is_int(Expr::ptr expr, int value) {
+    return expr != nullptr && expr->type == NODE_INT && static_pointer_cast<Int>(expr)->value == value;
+}
+
+// float k = 3; value = k / 2; divides as floats, like GLSL does
+static void test_float_local() {
+    Stmts::ptr stmts = make_shared<Stmts>(declare("float", "k", make_shared<Int>(3)));
+    stmts->list.push_back(assign_value(make_shared<Binary>(make_shared<Ident>("k"), OP_DIV, make_shared<Int>(2))));
+    Expr::ptr value = optimized_value(make_pair(make_shared<vector<Decl::ptr>>(), stmts));
+    check(value != nullptr && !is_int(value, 1), "float local given an int isn't divided as an int");
+    // The literal 2 is still an int, so the mixed division is left to the compiler
+    check(value != nullptr && value->type == NODE_BINARY && is_float(static_pointer_cast<Binary>(value)->lhs, 3.0f), "float local is propagated as a float");
+
+    stmts = make_shared<Stmts>(declare("float", "k", make_shared<Int>(3)));
+    stmts->list.push_back(assign_value(make_shared<Binary>(make_shared<Ident>("k"), OP_DIV, make_shared<Float>(2.0f))));
+    check(is_float(optimized_value(make_pair(make_shared<vector<Decl::ptr>>(), stmts)), 1.5f), "float local given an int folds to 1.5");
+}
+
+// const float k = 3; value = k / 2.0;
+static void test_float_constant() {
+    Decl::ptr constant = declare("float", "k", make_shared<Int>(3));
+    constant->constant = true;
+    auto uniforms = make_shared<vector<Decl::ptr>>(1, constant);
+    Stmts::ptr stmts = make_shared<Stmts>(assign_value(make_shared<Binary>(make_shared<Ident>("k"), OP_DIV, make_shared<Float>(2.0f))));
+    check(is_float(optimized_value(make_pair(uniforms, stmts)), 1.5f), "float constant given an int folds to 1.5");
+}
+
+// int k = 7; value = k / 2; still divides as ints
+static void test_int_local() {
+    Stmts::ptr stmts = make_shared<Stmts>(declare("int", "k", make_shared<Int>(7)));
+    stmts->list.push_back(assign_value(make_shared<Binary>(make_shared<Ident>("k"), OP_DIV, make_shared<Int>(2))));
+    check(is_int(optimized_value(make_pair(make_shared<vector<Decl::ptr>>(), stmts)), 3), "int local folds to 3");
+}
+
+// int k = 1.5; isn't valid GLSL, and the literal mustn't stand in for k either
+static void test_mismatched_local() {
+    Stmts::ptr stmts = make_shared<Stmts>(declare("int", "k", make_shared<Float>(1.5f)));
+    stmts->list.push_back(assign_value(make_shared<Binary>(make_shared<Ident>("k"), OP_MULT, make_shared<Float>(2.0f))));
+    check(!is_float(optimized_value(make_pair(make_shared<vector<Decl::ptr>>(), stmts)), 3.0f), "mismatched local isn't propagated");
+}
+
+int main() {
+    test_float_local();
+    test_float_constant();
+    test_int_local();
+    test_mismatched_local();
+
+    if(failures == 0) {
+        printf("glsloptimizer: all checks passed\n");
+    }
+    return failures == 0? 0 : 1;
+}
@@ -0,0 +1,85 @@
+// Runs small scripts against an offscreen context and checks what the interpreter reports about
+// each frame. Exits 77, which ctest counts as skipped, when no OpenGL context can be created
+#include <cstdio>
+#include <string>
+
+#include <QApplication>
+#include <QOffscreenSurface>
+#include <QOpenGLContext>
+#include <QOpenGLFunctions>
+
+#include "interpreter.h"
+#include "logwindow.h"
+
+using namespace std;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if(!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+// Whether the second run of the script's loop() is marked as one that may draw something else
+// next time, even if it issued the same GL commands
+static bool dynamic_after_loop(QOpenGLFunctions* functions, LogWindow* logger, const string& code) {
+    Wyatt::Interpreter interpreter(logger);
+    interpreter.load(Wyatt::Script::build(code + '\n', ".", logger));
+    interpreter.resize(64, 64);
+    interpreter.setFunctions(functions);
+    interpreter.prepare();
+    interpreter.compile_program();
+    interpreter.set_time(0, 0);
+    interpreter.execute_init();
+    interpreter.execute_loop();
+    interpreter.execute_loop();
+    return interpreter.dynamicFrame;
+}
+
+int main(int argc, char* argv[]) {
+    QApplication app(argc, argv);
+    QOffscreenSurface surface;
+    QOpenGLContext context;
+    surface.create();
+    if(!context.create() || !context.makeCurrent(&surface)) {
+        printf("interpreter: no OpenGL context, skipped\n");
+        return 77;
+    }
+    QOpenGLFunctions functions;
+    functions.initializeOpenGLFunctions();
+    LogWindow logger(0);
+    logger.echo = true;
+
+    check(!dynamic_after_loop(&functions, &logger,
+        "int counter = 0;\n"
+        "func init() {}\n"
+        "func loop() { int local = counter + 1; }"), "loop() reading globals settles");
+
+    check(dynamic_after_loop(&functions, &logger,
+        "int counter = 0;\n"
+        "func init() {}\n"
+        "func loop() { counter = counter + 1; }"), "assigning a global");
+
+    check(dynamic_after_loop(&functions, &logger,
+        "list counter = {0};\n"
+        "func init() {}\n"
+        "func loop() { counter[0] = counter[0] + 1; }"), "assigning an element of a global list");
+
+    check(dynamic_after_loop(&functions, &logger,
+        "list items = {};\n"
+        "func init() {}\n"
+        "func loop() { items += 1; }"), "appending to a global list");
+
+    check(dynamic_after_loop(&functions, &logger,
+        "vec3 position = [0, 0, 0];\n"
+        "func init() {}\n"
+        "func loop() { position[0] = position[0] + 1; }"), "assigning a component of a global vector");
+
+    context.doneCurrent();
+    if(failures == 0) {
+        printf("interpreter: all checks passed\n");
+    }
+    return failures == 0? 0 : 1;
+}
@@ -0,0 +1,164 @@
+// Parses hand-built KTX and DDS files; exits non-zero if any check fails. Needs neither Qt nor GL
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "texturecontainer.h"
+
+using namespace std;
+using namespace Wyatt;
+
+static int failures = 0;
+
+static void check(bool condition, const char* what) {
+    if(!condition) {
+        printf("FAIL: %s\n", what);
+        failures++;
+    }
+}
+
+static void put_u32(vector<unsigned char>& data, size_t offset, unsigned int value) {
+    if(data.size() < offset + 4) {
+        data.resize(offset + 4);
+    }
+    memcpy(&data[offset], &value, 4);
+}
+
+// A BC1 (8 bytes per block) KTX file of width x height with the given number of levels
+static vector<unsigned char> make_ktx(unsigned int width, unsigned int height, unsigned int mipmaps) {
+    static const unsigned char identifier[12] = { 0xAB, 'K', 'T', 'X', ' ', '1', '1', 0xBB, '\r', '\n', 0x1A, '\n' };
+    vector<unsigned char> data(64, 0);
+    memcpy(&data[0], identifier, 12);
+    put_u32(data, 12, 0x04030201);
+    put_u32(data, 28, GL_COMPRESSED_RGBA_S3TC_DXT1_EXT);
+    put_u32(data, 36, width);
+    put_u32(data, 40, height);
+    put_u32(data, 52, 1);
+    put_u32(data, 56, mipmaps);
+    for(unsigned int i = 0; i < mipmaps; i++) {
+        unsigned int w = max(1u, width >> i), h = max(1u, height >> i);
+        unsigned int bytes = (w + 3) / 4 * ((h + 3) / 4) * 8;
+        put_u32(data, data.size(), bytes);
+        data.resize(data.size() + bytes, 0);
+    }
+    return data;
+}
+
+// A DXT5 (16 bytes per block) DDS file of width x height with the given number of levels
+static vector<unsigned char> make_dds(unsigned int width, unsigned int height, unsigned int mipmaps) {
+    vector<unsigned char> data(128, 0);
+    memcpy(&data[0], "DDS ", 4);
+    put_u32(data, 4, 124);
+    put_u32(data, 8, 0x20000);
+    put_u32(data, 12, height);
+    put_u32(data, 16, width);
+    put_u32(data, 28, mipmaps);
+    put_u32(data, 80, 0x4);
+    memcpy(&data[84], "DXT5", 4);
+    for(unsigned int i = 0; i < mipmaps; i++) {
+        unsigned int w = max(1u, width >> i), h = max(1u, height >> i);
+        data.resize(data.size() + (w + 3) / 4 * ((h + 3) / 4) * 16, 0);
+    }
+    return data;
+}
+
+static bool parse(const vector<unsigned char>& data, TextureContainer& container, string& error) {
+    return parse_container(data.data(), data.size(), 4096, container, error);
+}
+
+static void test_ktx() {
+    TextureContainer container;
+    string error;
+
+    vector<unsigned char> ktx = make_ktx(16, 8, 5);
+    check(parse(ktx, container, error), "KTX parses");
+    check(container.format == GL_COMPRESSED_RGBA_S3TC_DXT1_EXT, "KTX format");
+    check(container.width == 16 && container.height == 8, "KTX size");
+    check(container.levels.size() == 5, "KTX level count");
+    check(container.levels[1].width == 8 && container.levels[1].height == 4, "KTX level 1 size");
+    check(container.levels[4].width == 1 && container.levels[4].height == 1, "KTX last level size");
+    check(container.levels[0].offset == 68 && container.levels[0].size == 64, "KTX level 0 range");
+
+    vector<unsigned char> header(ktx.begin(), ktx.begin() + 40);
+    check(!parse(header, container, error) && error == "truncated KTX header", "KTX truncated header");
+
+    vector<unsigned char> level(ktx.begin(), ktx.end() - 1);
+    check(!parse(level, container, error) && error == "truncated KTX mip level 4", "KTX truncated level");
+
+    vector<unsigned char> endianness = ktx;
+    put_u32(endianness, 12, 0x12345678);
+    check(!parse(endianness, container, error) && error == "bad KTX endianness", "KTX bad endianness");
+
+    vector<unsigned char> mipmaps = ktx;
+    put_u32(mipmaps, 56, 6);
+    check(!parse(mipmaps, container, error) && error.find("at most 5") != string::npos, "KTX too many mip levels");
+
+    vector<unsigned char> shift = ktx;
+    put_u32(shift, 56, 40);
+    check(!parse(shift, container, error), "KTX mip levels past 32 bits");
+
+    vector<unsigned char> large = ktx;
+    put_u32(large, 36, 0x80000000u);
+    check(!parse(large, container, error) && error.find("larger than") != string::npos, "KTX larger than INT_MAX");
+    put_u32(large, 36, 8192);
+    check(!parse(large, container, error) && error.find("larger than the 4096") != string::npos, "KTX larger than the GL limit");
+
+    vector<unsigned char> uncompressed = ktx;
+    put_u32(uncompressed, 16, 0x1401);
+    check(!parse(uncompressed, container, error), "KTX uncompressed");
+}
+
+static void test_dds() {
+    TextureContainer container;
+    string error;
+
+    vector<unsigned char> dds = make_dds(8, 8, 4);
+    check(parse(dds, container, error), "DDS parses");
+    check(container.format == GL_COMPRESSED_RGBA_S3TC_DXT5_EXT, "DDS format");
+    check(container.width == 8 && container.height == 8, "DDS size");
+    check(container.levels.size() == 4, "DDS level count");
+    check(container.levels[0].offset == 128 && container.levels[0].size == 64, "DDS level 0 range");
+    check(container.levels[3].width == 1 && container.levels[3].size == 16, "DDS last level");
+
+    vector<unsigned char> header(dds.begin(), dds.begin() + 100);
+    check(!parse(header, container, error) && error == "truncated DDS header", "DDS truncated header");
+
+    vector<unsigned char> level(dds.begin(), dds.end() - 1);
+    check(!parse(level, container, error) && error == "truncated DDS mip level 3", "DDS truncated level");
+
+    vector<unsigned char> dx10 = dds;
+    memcpy(&dx10[84], "DX10", 4);
+    dx10.resize(140);
+    check(!parse(dx10, container, error) && error == "truncated DDS DX10 header", "DDS truncated DX10 header");
+
+    vector<unsigned char> mipmaps = dds;
+    put_u32(mipmaps, 28, 5);
+    check(!parse(mipmaps, container, error) && error.find("at most 4") != string::npos, "DDS too many mip levels");
+
+    vector<unsigned char> large = dds;
+    put_u32(large, 12, 0xFFFFFFFFu);
+    check(!parse(large, container, error) && error.find("larger than") != string::npos, "DDS larger than INT_MAX");
+
+    vector<unsigned char> cubemap = dds;
+    put_u32(cubemap, 112, 0x200);
+    check(!parse(cubemap, container, error), "DDS cubemap");
+}
+
+int main() {
+    test_ktx();
+    test_dds();
+
+    TextureContainer container;
+    string error;
+    vector<unsigned char> png = { 0x89, 'P', 'N', 'G', '\r', '\n', 0x1A, '\n' };
+    check(!parse(png, container, error) && error == "not a KTX or DDS file", "not a container");
+    check(!parse(vector<unsigned char>(), container, error), "empty file");
+    check(is_container("a/b.KTX") && is_container("c.dds") && !is_container("d.png") && !is_container("ktx"), "is_container");
+
+    if(failures == 0) {
+        printf("texturecontainer: all checks passed\n");
+    }
+    return failures == 0? 0 : 1;
+}